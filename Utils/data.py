@@ -1,5 +1,7 @@
+import json
 import pandas as pd
 import os
+import numpy as np
 
 
 def load_data(data_dir: str, dtypes: dict, sep=';') -> list[pd.DataFrame]:
@@ -24,3 +26,51 @@ def average_dataframe(dataframes: list[pd.DataFrame], columns: list[str]) -> pd.
     df_avg.div(len(dataframes))
     return df_avg
 
+
+
+def load_columns(run_dir: str) -> dict:
+    """Memory maps the binary columns of one run written with --format npy, returns them with the run metadata"""
+    with open(os.path.join(run_dir, 'meta.json')) as meta_file:
+        meta = json.load(meta_file)
+    columns = {column['name']: np.load(os.path.join(run_dir, column['file']), mmap_mode='r')
+               for column in meta['columns']}
+    return {'meta': meta, 'columns': columns}
+
+
+def load_binary_data(data_dir: str) -> list[pd.DataFrame]:
+    """Loads all runs written with --format npy into a pandas.DataFrame and returns them as a list"""
+    dataframes = []
+    for root, _, files in sorted(os.walk(data_dir)):
+        if 'meta.json' in files:
+            run = load_columns(root)
+            df = pd.DataFrame(run['columns'], copy=False)
+            df.attrs = run['meta']
+            dataframes.append(df)
+    return dataframes
+
+
+def load_space_time(path: str) -> tuple[np.memmap, dict]:
+    """Memory maps a space-time matrix written with --space-time, returns it with its description"""
+    with open(os.path.splitext(path)[0] + '.json') as meta_file:
+        meta = json.load(meta_file)
+    return np.load(path, mmap_mode='r'), meta
+
+
+def compare_update_rules(data_dir: str, parameter: str = 'arrival_interval') -> pd.DataFrame:
+    """Compares the mean density and flux of sweeps of both update rules written by make update_rules
+
+    Returns the means of both rules for every swept value with the z score of their difference,
+    computed from the standard errors over the replications.
+    """
+    rules = {}
+    for rule in ('sequential', 'synchronous'):
+        sweep = pd.read_csv(os.path.join(data_dir, rule, 'sweep.csv'), sep=';')
+        rules[rule] = sweep.groupby(parameter)[['density', 'flux']].agg(['mean', 'sem'])
+    sequential, synchronous = rules['sequential'], rules['synchronous']
+    comparison = pd.DataFrame(index=sequential.index)
+    for column in ('density', 'flux'):
+        comparison[column + '_sequential'] = sequential[column]['mean']
+        comparison[column + '_synchronous'] = synchronous[column]['mean']
+        error = np.sqrt(sequential[column]['sem'] ** 2 + synchronous[column]['sem'] ** 2)
+        comparison[column + '_z'] = (synchronous[column]['mean'] - sequential[column]['mean']) / error
+    return comparison
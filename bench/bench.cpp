@@ -0,0 +1,416 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 22-12-2023
+ * @file bench.cpp
+ *
+ * Micro-benchmarks of the road engines, results are printed as json
+ */
+
+#include "include/RoadMap.h"
+#include "include/RoadVehicleList.h"
+#include "include/RoadMapParallel.h"
+#include "include/RoadSimd.h"
+#include "include/TrafficData.h"
+#include "include/args.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using bench_clock = std::chrono::steady_clock;
+
+/**
+ * Road with access to its storage, so it can be filled to a given density
+ */
+template <typename Engine>
+class BenchRoad : public Engine {
+public:
+    using Engine::Engine;
+    using Road::insert_vehicle_from_queue;
+
+    static std::unique_ptr<BenchRoad> create(uint32_t road_length);
+
+    /**
+     * Fill the road from its end with vehicles separated by random gaps
+     * @param density portion of the cells covered by vehicles
+     * @param truck_ratio portion of trucks among the vehicles, the rest are cars
+     */
+    void fill(float density, float truck_ratio, std::mt19937& gen) {
+        this->reset(this->m_max_speed * Road::METERS_PER_CELL, two_lane_portion(), StreamKey {1, 0});
+        if (density <= 0) {
+            return;
+        }
+        for (uint8_t lane = 0; lane < lanes(); ++lane) {
+            std::bernoulli_distribution truck(truck_ratio);
+            int32_t front = this->m_cell_count - 1;
+            while (true) {
+                Vehicle vehicle(truck(gen) ? vt_t::truck : vt_t::car);
+                // Geometric gaps, so the vehicles cover the density portion of the cells on average
+                std::geometric_distribution<int32_t> gap(density);
+                int32_t distance = vehicle.length() == 1 ? gap(gen) : gap(gen) * vehicle.length();
+                front -= distance;
+                if (front - vehicle.length() + 1 < lane_begin(lane)) {
+                    break;
+                }
+                vehicle.set_speed(std::min<int32_t>(distance, this->m_max_speed));
+                place(lane, front, vehicle);
+                front -= vehicle.length();
+            }
+        }
+    }
+
+    /**
+     * Cells updated in a step, the left lane of a two lane road exists only from its beginning
+     */
+    uint32_t cells() const {
+        uint32_t cells = 0;
+        for (uint8_t lane = 0; lane < lanes(); ++lane) {
+            cells += this->m_cell_count - lane_begin(lane);
+        }
+        return cells;
+    }
+
+private:
+    uint8_t lanes() const;
+
+    int32_t lane_begin(uint8_t lane) const;
+
+    uint8_t two_lane_portion() const;
+
+    void place(uint8_t lane, int32_t front, const Vehicle& vehicle);
+};
+
+template <>
+std::unique_ptr<BenchRoad<RoadMap>> BenchRoad<RoadMap>::create(uint32_t road_length) {
+    return std::make_unique<BenchRoad>(road_length, MAX_SPEED_MS, 0, StreamKey {1, 0});
+}
+
+template <>
+uint8_t BenchRoad<RoadMap>::lanes() const {
+    return 1;
+}
+
+template <>
+int32_t BenchRoad<RoadMap>::lane_begin(uint8_t) const {
+    return 0;
+}
+
+template <>
+uint8_t BenchRoad<RoadMap>::two_lane_portion() const {
+    return 0;
+}
+
+template <>
+void BenchRoad<RoadMap>::place(uint8_t lane, int32_t front, const Vehicle& vehicle) {
+    m_road[lane].set(front, vehicle);
+}
+
+template <>
+std::unique_ptr<BenchRoad<RoadMapParallel>> BenchRoad<RoadMapParallel>::create(uint32_t road_length) {
+    return std::make_unique<BenchRoad>(road_length, MAX_SPEED_MS, StreamKey {1, 0});
+}
+
+template <>
+uint8_t BenchRoad<RoadMapParallel>::lanes() const {
+    return 1;
+}
+
+template <>
+int32_t BenchRoad<RoadMapParallel>::lane_begin(uint8_t) const {
+    return 0;
+}
+
+template <>
+uint8_t BenchRoad<RoadMapParallel>::two_lane_portion() const {
+    return 0;
+}
+
+template <>
+void BenchRoad<RoadMapParallel>::place(uint8_t lane, int32_t front, const Vehicle& vehicle) {
+    m_road[lane].set(front, vehicle);
+}
+
+template <>
+std::unique_ptr<BenchRoad<RoadMapTwoLane>> BenchRoad<RoadMapTwoLane>::create(uint32_t road_length) {
+    return std::make_unique<BenchRoad>(road_length, MAX_SPEED_MS, 50, StreamKey {1, 0});
+}
+
+template <>
+uint8_t BenchRoad<RoadMapTwoLane>::lanes() const {
+    return 2;
+}
+
+template <>
+int32_t BenchRoad<RoadMapTwoLane>::lane_begin(uint8_t lane) const {
+    return lane == LEFT_LANE ? m_left_lane_begin : 0;
+}
+
+template <>
+uint8_t BenchRoad<RoadMapTwoLane>::two_lane_portion() const {
+    return 50;
+}
+
+template <>
+void BenchRoad<RoadMapTwoLane>::place(uint8_t lane, int32_t front, const Vehicle& vehicle) {
+    m_road[lane].set(front, vehicle);
+}
+
+template <>
+std::unique_ptr<BenchRoad<RoadVehicleList>> BenchRoad<RoadVehicleList>::create(uint32_t road_length) {
+    return std::make_unique<BenchRoad>(road_length, MAX_SPEED_MS, StreamKey {1, 0});
+}
+
+template <>
+uint8_t BenchRoad<RoadVehicleList>::lanes() const {
+    return 1;
+}
+
+template <>
+int32_t BenchRoad<RoadVehicleList>::lane_begin(uint8_t) const {
+    return 0;
+}
+
+template <>
+uint8_t BenchRoad<RoadVehicleList>::two_lane_portion() const {
+    return 0;
+}
+
+template <>
+void BenchRoad<RoadVehicleList>::place(uint8_t, int32_t front, const Vehicle& vehicle) {
+    // Filled from the end of the road, so the positions stay descending
+    m_position.push_back(front);
+    m_vehicles.push_back(vehicle);
+}
+
+template <>
+std::unique_ptr<BenchRoad<RoadSimd>> BenchRoad<RoadSimd>::create(uint32_t road_length) {
+    return std::make_unique<BenchRoad>(road_length, MAX_SPEED_MS, StreamKey {1, 0});
+}
+
+template <>
+uint8_t BenchRoad<RoadSimd>::lanes() const {
+    return 1;
+}
+
+template <>
+int32_t BenchRoad<RoadSimd>::lane_begin(uint8_t) const {
+    return 0;
+}
+
+template <>
+uint8_t BenchRoad<RoadSimd>::two_lane_portion() const {
+    return 0;
+}
+
+template <>
+void BenchRoad<RoadSimd>::place(uint8_t, int32_t front, const Vehicle& vehicle) {
+    m_position.push_back(front);
+    m_speed.push_back(vehicle.get_raw_speed());
+}
+
+/**
+ * Timing of one benchmark case
+ */
+struct BenchResult {
+    std::string name;
+    std::string params;
+    /**
+     * Nanoseconds per operation of every repetition
+     */
+    std::vector<double> samples;
+    /**
+     * Cells updated by one operation, 0 if the case does not update cells
+     */
+    uint32_t cells;
+};
+
+struct BenchOptions {
+    uint32_t warmup;
+    uint32_t repetitions;
+    /**
+     * Operations timed together in one repetition
+     */
+    uint32_t batch;
+    std::string filter;
+};
+
+/**
+ * Run the timed operation after an untimed setup in every repetition
+ * @param setup prepares the state, not timed
+ * @param operation timed batch times per repetition
+ */
+static std::vector<double> measure(const BenchOptions& options, const std::function<void()>& setup,
+                                   const std::function<void()>& operation) {
+    std::vector<double> samples;
+    samples.reserve(options.repetitions);
+    for (uint32_t r = 0; r < options.warmup + options.repetitions; ++r) {
+        setup();
+        auto start = bench_clock::now();
+        for (uint32_t i = 0; i < options.batch; ++i) {
+            operation();
+        }
+        auto elapsed = std::chrono::duration<double, std::nano>(bench_clock::now() - start).count();
+        if (r >= options.warmup) {
+            samples.push_back(elapsed / options.batch);
+        }
+    }
+    return samples;
+}
+
+static double percentile(std::vector<double> samples, double portion) {
+    std::sort(samples.begin(), samples.end());
+    size_t index = static_cast<size_t>(std::ceil(portion * samples.size()));
+    return samples[index > 0 ? index - 1 : 0];
+}
+
+template <typename Engine>
+static void bench_update(const std::string& name, const BenchOptions& options, std::vector<BenchResult>& results,
+                         const std::vector<uint32_t>& road_lengths, const std::vector<float>& densities,
+                         const std::vector<float>& truck_ratios) {
+    if (name.find(options.filter) == std::string::npos) {
+        return;
+    }
+    for (auto road_length : road_lengths) {
+        for (auto density : densities) {
+            for (auto truck_ratio : truck_ratios) {
+                auto road = BenchRoad<Engine>::create(road_length);
+                road->set_snapshots(false);
+                std::mt19937 gen(road_length);
+                TrafficDataSample sample {};
+                auto samples = measure(options,
+                                       [&] { road->fill(density, truck_ratio, gen); },
+                                       [&] { road->update(sample); });
+                std::ostringstream params;
+                params << "\"road_length_m\": " << road_length << ", \"density\": " << density
+                       << ", \"truck_ratio\": " << truck_ratio;
+                results.push_back({name, params.str(), samples, road->cells()});
+            }
+        }
+    }
+}
+
+static void bench_insert(const BenchOptions& options, std::vector<BenchResult>& results) {
+    if (std::string("insert").find(options.filter) == std::string::npos &&
+        std::string("insert_from_queue").find(options.filter) == std::string::npos) {
+        return;
+    }
+    BenchRoad<RoadMap> road(ROAD_LENGTH_M, MAX_SPEED_MS, 0, StreamKey {1, 0});
+    std::mt19937 gen(1);
+    // The entry is free, the vehicle is placed right away, so only one insertion fits in a repetition
+    BenchOptions single = options;
+    single.batch = 1;
+    results.push_back({"insert", "\"entry\": \"free\"", measure(single,
+        [&] { road.fill(0, 0, gen); },
+        [&] { road.insert(Vehicle(vt_t::car)); }), 0});
+    // The entry is blocked, the vehicle waits in the queue
+    results.push_back({"insert", "\"entry\": \"blocked\"", measure(options,
+        [&] { road.fill(0, 0, gen); road.insert(Vehicle(vt_t::truck)); },
+        [&] { road.insert(Vehicle(vt_t::car)); }), 0});
+    // The vehicle at the head of the queue cannot enter yet
+    results.push_back({"insert_from_queue", "\"entry\": \"blocked\"", measure(options,
+        [&] { road.fill(0, 0, gen); road.insert(Vehicle(vt_t::truck)); road.insert(Vehicle(vt_t::car)); },
+        [&] { road.insert_vehicle_from_queue(); }), 0});
+}
+
+static void bench_to_csv(const BenchOptions& options, std::vector<BenchResult>& results) {
+    if (std::string("to_csv").find(options.filter) == std::string::npos) {
+        return;
+    }
+    for (bool snapshots : {false, true}) {
+        BenchRoad<RoadMap> road(ROAD_LENGTH_M, MAX_SPEED_MS, 0, StreamKey {1, 0});
+        road.set_snapshots(snapshots);
+        std::mt19937 gen(1);
+        road.fill(0.3, 0.2, gen);
+        OneLaneTrafficData data(snapshots);
+        const uint32_t rows = 1000;
+        TrafficDataSample sample {};
+        for (uint32_t i = 0; i < rows; ++i) {
+            road.update(sample);
+            data.add_sample(sample);
+        }
+        size_t length = 0;
+        auto samples = measure(options, [] {}, [&] { length += data.to_csv().size(); });
+        // Per row instead of per call
+        for (auto& value : samples) {
+            value /= rows;
+        }
+        results.push_back({"to_csv", std::string("\"snapshots\": ") + (snapshots ? "true" : "false") +
+                                     ", \"road_length_m\": " + std::to_string(ROAD_LENGTH_M), samples, 0});
+    }
+}
+
+int main(int argc, char* argv[]) {
+    args::ArgumentParser parser("Micro-benchmarks of the road engines");
+    args::HelpFlag help(parser, "help", "Display help", {'h', "help"});
+    args::ValueFlag<uint32_t> warmup(parser, "Warm-up", "Untimed repetitions before the measurement", {"warmup"}, 3);
+    // The p99 is above the maximum of the other repetitions only with 100 or more of them
+    args::ValueFlag<uint32_t> repetitions(parser, "Repetitions", "Timed repetitions of every case, the p99 needs at least 100",
+                                          {"repetitions"}, 101);
+    args::ValueFlag<uint32_t> batch(parser, "Batch", "Operations timed together in one repetition", {"batch"}, 8);
+    args::ValueFlag<std::string> filter(parser, "Filter", "Run only the cases whose name contains the text", {"filter"}, "");
+    args::ValueFlag<std::string> label(parser, "Label", "Label of the run, e.g. the commit", {"label"}, "");
+    args::Flag quick(parser, "Quick", "Only the short roads", {"quick"});
+
+    try {
+        parser.ParseCLI(argc, argv);
+    }
+    catch (args::Help&) {
+        std::cout << parser;
+        return EXIT_SUCCESS;
+    }
+    catch (args::Error& e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << parser;
+        return EXIT_FAILURE;
+    }
+    if (args::get(repetitions) == 0 || args::get(batch) == 0) {
+        std::cerr << "At least one repetition of one operation has to be timed" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    BenchOptions options {args::get(warmup), args::get(repetitions), args::get(batch), args::get(filter)};
+    std::vector<uint32_t> road_lengths {400, 2000, 10000, 100000};
+    if (quick) {
+        road_lengths = {400, 2000};
+    }
+    std::vector<float> densities {0, 0.1, 0.3, 0.6, 0.9};
+    std::vector<float> truck_ratios {0, 0.2};
+
+    std::vector<BenchResult> results;
+    bench_update<RoadMap>("RoadMap::update", options, results, road_lengths, densities, truck_ratios);
+    bench_update<RoadMapTwoLane>("RoadMapTwoLane::update", options, results, road_lengths, densities, truck_ratios);
+    bench_update<RoadVehicleList>("RoadVehicleList::update", options, results, road_lengths, densities, truck_ratios);
+    bench_update<RoadMapParallel>("RoadMapParallel::update", options, results, road_lengths, densities, truck_ratios);
+    // Cars only
+    bench_update<RoadSimd>("RoadSimd::update", options, results, road_lengths, densities, {0});
+    bench_insert(options, results);
+    bench_to_csv(options, results);
+
+    std::cout << "{\n";
+    std::cout << "  \"label\": \"" << args::get(label) << "\",\n";
+    std::cout << "  \"warmup\": " << options.warmup << ", \"repetitions\": " << options.repetitions
+              << ", \"batch\": " << options.batch << ",\n";
+    std::cout << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& result = results[i];
+        double median = percentile(result.samples, 0.5);
+        std::cout << "    {\"name\": \"" << result.name << "\", " << result.params
+                  << ", \"ns_median\": " << median
+                  << ", \"ns_p99\": " << percentile(result.samples, 0.99)
+                  << ", \"ns_max\": " << percentile(result.samples, 1)
+                  << ", \"ns_min\": " << percentile(result.samples, 0);
+        if (result.cells > 0) {
+            std::cout << ", \"cell_updates_per_s\": " << result.cells / median * 1e9;
+        }
+        std::cout << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    std::cout << "  ]\n";
+    std::cout << "}\n";
+}
@@ -0,0 +1,53 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 31-12-2023
+ * @file AliasTable.cpp
+ */
+
+#include "include/AliasTable.h"
+
+#include <stdexcept>
+
+AliasTable::AliasTable(const std::vector<int>& weights) : m_threshold(weights.size()), m_alias(weights.size()) {
+    uint64_t total = 0;
+    for (int weight : weights) {
+        if (weight < 0) {
+            throw std::invalid_argument("Weights of a distribution cannot be negative");
+        }
+        total += static_cast<uint64_t>(weight);
+    }
+    if (total == 0) {
+        throw std::invalid_argument("Weights of a distribution have to have a positive sum");
+    }
+
+    // Vose's construction: every column is filled up to the mean weight (total / size) from the heaviest ones,
+    // the weights are scaled by the size so they are compared against the total in integers
+    uint64_t count = weights.size();
+    std::vector<uint64_t> scaled(count);
+    std::vector<uint32_t> small;
+    std::vector<uint32_t> large;
+    for (uint32_t i = 0; i < count; ++i) {
+        scaled[i] = static_cast<uint64_t>(weights[i]) * count;
+        m_alias[i] = i;
+        (scaled[i] < total ? small : large).push_back(i);
+    }
+    while (!small.empty() && !large.empty()) {
+        uint32_t less = small.back();
+        small.pop_back();
+        uint32_t more = large.back();
+        m_threshold[less] = static_cast<uint64_t>((static_cast<unsigned __int128>(scaled[less]) << 32) / total);
+        m_alias[less] = more;
+        scaled[more] -= total - scaled[less];
+        if (scaled[more] < total) {
+            large.pop_back();
+            small.push_back(more);
+        }
+    }
+    // The remaining columns are exactly full
+    for (uint32_t i : large) {
+        m_threshold[i] = uint64_t(1) << 32;
+    }
+    for (uint32_t i : small) {
+        m_threshold[i] = uint64_t(1) << 32;
+    }
+}
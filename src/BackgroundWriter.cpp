@@ -0,0 +1,105 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 19-12-2023
+ * @file BackgroundWriter.cpp
+ */
+
+#include "include/BackgroundWriter.h"
+#include "include/Tracer.h"
+
+#include <stdexcept>
+
+std::atomic<bool> BackgroundWriter::s_failed {false};
+
+BackgroundWriter::BackgroundWriter(std::ostream& output, size_t max_pending)
+        : m_output(output), m_max_pending(max_pending), m_pending(max_pending), m_closing(false), m_failed(false) {
+    m_spare.reserve(max_pending + 2);
+    m_thread = std::thread(&BackgroundWriter::run, this);
+}
+
+BackgroundWriter::BackgroundWriter(const std::filesystem::path& path, size_t max_pending)
+        : m_file(path, std::ios::binary), m_output(m_file), m_max_pending(max_pending), m_pending(max_pending), m_closing(false), m_failed(false) {
+    if (!m_file) {
+        throw std::runtime_error("Cannot open output file " + path.string());
+    }
+    m_spare.reserve(max_pending + 2);
+    m_thread = std::thread(&BackgroundWriter::run, this);
+}
+
+BackgroundWriter::~BackgroundWriter() {
+    stop();
+}
+
+void BackgroundWriter::write(std::string chunk) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_pending.size() >= m_max_pending) {
+        // The writer does not keep up, show how long the producer waits
+        TraceSpan span("write stall", "output");
+        m_changed.wait(lock, [this] { return m_pending.size() < m_max_pending; });
+    }
+    m_pending.push(std::move(chunk));
+    m_changed.notify_all();
+}
+
+std::string BackgroundWriter::take_buffer() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_spare.empty()) {
+        return {};
+    }
+    std::string buffer = std::move(m_spare.back());
+    m_spare.pop_back();
+    return buffer;
+}
+
+void BackgroundWriter::close() {
+    stop();
+    if (m_failed) {
+        throw std::runtime_error("Writing the output failed");
+    }
+}
+
+bool BackgroundWriter::failed() {
+    return s_failed;
+}
+
+void BackgroundWriter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closing = true;
+    }
+    m_changed.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void BackgroundWriter::run() {
+    Tracer::set_thread_name("writer");
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_changed.wait(lock, [this] { return m_closing || !m_pending.empty(); });
+        if (m_pending.empty()) {
+            break; // Closing and everything has been written
+        }
+        std::string chunk = std::move(m_pending.front());
+        m_pending.pop();
+        m_changed.notify_all();
+
+        lock.unlock();
+        // After a failure the chunks are only taken, so the producers are not blocked
+        if (!m_failed) {
+            TraceSpan span("flush", "output", true, chunk.size());
+            m_output.write(chunk.data(), chunk.size());
+            m_output.flush(); // Make the results visible while the simulation runs
+            if (!m_output) {
+                m_failed = true;
+                s_failed = true;
+            }
+        }
+        chunk.clear();
+        lock.lock();
+        if (m_spare.size() < m_spare.capacity()) {
+            m_spare.push_back(std::move(chunk));
+        }
+    }
+}
@@ -0,0 +1,106 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 24-12-2023
+ * @file HardwareCounters.cpp
+ */
+
+#include "include/HardwareCounters.h"
+
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const std::array<const char*, HardwareCounters::EVENT_COUNT> HardwareCounters::EVENT_NAMES {
+        "cycles", "instructions", "L1d misses", "LLC misses", "branch misses"};
+
+#ifdef __linux__
+
+static int open_event(uint32_t type, uint64_t config, int group) {
+    perf_event_attr attr {};
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.disabled = group < 0; // The group starts with its leader
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+}
+
+HardwareCounters::HardwareCounters() : m_leader(-1), m_open(0) {
+    m_fd.fill(-1);
+    m_slot.fill(-1);
+    const std::array<std::pair<uint32_t, uint64_t>, EVENT_COUNT> events {{
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 |
+                                 PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    }};
+    for (int e = 0; e < EVENT_COUNT; ++e) {
+        int fd = open_event(events[e].first, events[e].second, m_leader);
+        if (fd < 0) {
+            std::string reason = std::strerror(errno);
+            m_error += std::string(m_error.empty() ? "" : ", ") + EVENT_NAMES[e] + ": " + reason;
+            continue;
+        }
+        if (m_leader < 0) {
+            m_leader = fd;
+        }
+        m_fd[e] = fd;
+        m_slot[e] = m_open++;
+    }
+    if (available()) {
+        ioctl(m_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(m_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+HardwareCounters::~HardwareCounters() {
+    for (int fd : m_fd) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+HardwareCounters::Values HardwareCounters::read() const {
+    Values values {};
+    if (!available()) {
+        return values;
+    }
+    // Group read format: number of events followed by their values
+    uint64_t buffer[EVENT_COUNT + 1];
+    if (::read(m_leader, buffer, sizeof(uint64_t) * (m_open + 1)) <= 0) {
+        return values;
+    }
+    for (int e = 0; e < EVENT_COUNT; ++e) {
+        if (m_slot[e] >= 0) {
+            values[e] = buffer[m_slot[e] + 1];
+        }
+    }
+    return values;
+}
+
+#else
+
+HardwareCounters::HardwareCounters() : m_leader(-1), m_open(0) {
+    m_fd.fill(-1);
+    m_slot.fill(-1);
+    m_error = "perf_event_open is only available on Linux";
+}
+
+HardwareCounters::~HardwareCounters() = default;
+
+HardwareCounters::Values HardwareCounters::read() const {
+    return {};
+}
+
+#endif
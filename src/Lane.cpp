@@ -0,0 +1,30 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 12-12-2023
+ * @file Lane.cpp
+ */
+
+#include "include/Lane.h"
+
+#include <algorithm>
+
+Lane::Lane(uint32_t cells) : m_type(cells, EMPTY_CELL), m_speed(cells, 0),
+                             m_heads((cells + WORD_BITS - 1) / WORD_BITS, 0),
+                             m_reach{m_heads, m_heads} {
+}
+
+void Lane::reset() {
+    std::fill(m_type.begin(), m_type.end(), EMPTY_CELL);
+    std::fill(m_heads.begin(), m_heads.end(), 0);
+    std::fill(m_reach[0].begin(), m_reach[0].end(), 0);
+    std::fill(m_reach[1].begin(), m_reach[1].end(), 0);
+}
+
+void Lane::reset(uint32_t first, uint32_t end) {
+    std::fill(m_type.begin() + first, m_type.begin() + end, EMPTY_CELL);
+    uint32_t first_word = first / WORD_BITS;
+    uint32_t end_word = (end + WORD_BITS - 1) / WORD_BITS;
+    std::fill(m_heads.begin() + first_word, m_heads.begin() + end_word, 0);
+    std::fill(m_reach[0].begin() + first_word, m_reach[0].begin() + end_word, 0);
+    std::fill(m_reach[1].begin() + first_word, m_reach[1].begin() + end_word, 0);
+}
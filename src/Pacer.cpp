@@ -0,0 +1,46 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 15-12-2023
+ * @file Pacer.cpp
+ */
+
+#include "include/Pacer.h"
+
+#include <thread>
+
+Pacer::Pacer() : m_mode(Mode::Batch), m_period(0), m_steps(0), m_missed(0) {
+}
+
+Pacer::Pacer(float steps_per_second) : m_mode(Mode::Paced),
+                                       m_period(std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / steps_per_second))),
+                                       m_steps(0), m_missed(0) {
+}
+
+void Pacer::start() {
+    m_steps = 0;
+    m_missed = 0;
+    if (m_mode == Mode::Paced) {
+        m_start = clock::now();
+    }
+}
+
+void Pacer::step() {
+    if (m_mode == Mode::Batch) {
+        return;
+    }
+    m_steps++;
+    auto deadline = m_start + m_steps * m_period;
+    if (clock::now() > deadline) {
+        m_missed++;
+        return;
+    }
+    std::this_thread::sleep_until(deadline);
+}
+
+Pacer::Mode Pacer::mode() const {
+    return m_mode;
+}
+
+uint64_t Pacer::missed_frames() const {
+    return m_missed;
+}
@@ -0,0 +1,155 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 17-12-2023
+ * @file ParameterSweep.cpp
+ */
+
+#include "include/ParameterSweep.h"
+#include "include/TrafficDataSinks.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+static const std::map<std::string, int SimulationParameters::*> SWEPT_PARAMETERS {
+        {"arrival-interval", &SimulationParameters::arrival_interval},
+        {"two-lane-portion", &SimulationParameters::left_lane_portion},
+        {"max-speed", &SimulationParameters::max_speed_ms},
+};
+
+static int parse_int(const std::string& value, const std::string& spec) {
+    try {
+        size_t parsed;
+        int result = std::stoi(value, &parsed);
+        if (parsed == value.size()) {
+            return result;
+        }
+    }
+    catch (std::logic_error&) {
+    }
+    throw std::invalid_argument("Invalid value '" + value + "' in sweep " + spec);
+}
+
+ParameterSweep::ParameterSweep(const SimulationParameters& base) : m_base(base) {
+}
+
+void ParameterSweep::add(const std::string& spec) {
+    auto separator = spec.find('=');
+    if (separator == std::string::npos) {
+        throw std::invalid_argument("Sweep has to be given as parameter=values: " + spec);
+    }
+    std::string name = spec.substr(0, separator);
+    auto parameter = SWEPT_PARAMETERS.find(name);
+    // The portions of the vehicle classes are swept by the names of the classes
+    int vehicle_class = VehicleClasses::table().find(name);
+    if (parameter == SWEPT_PARAMETERS.end() && vehicle_class < 0) {
+        throw std::invalid_argument("Parameter cannot be swept: " + name);
+    }
+    std::string values = spec.substr(separator + 1);
+
+    Axis axis {parameter != SWEPT_PARAMETERS.end() ? parameter->second : nullptr, vehicle_class, {}};
+    if (values.find(':') != std::string::npos) {
+        // Range first:last[:step]
+        std::vector<int> bounds;
+        std::istringstream range(values);
+        std::string bound;
+        while (std::getline(range, bound, ':')) {
+            bounds.push_back(parse_int(bound, spec));
+        }
+        if (bounds.size() < 2 || bounds.size() > 3) {
+            throw std::invalid_argument("Range has to be given as first:last[:step]: " + spec);
+        }
+        int step = bounds.size() == 3 ? bounds[2] : 1;
+        if (step <= 0 || bounds[0] > bounds[1]) {
+            throw std::invalid_argument("Range has to be increasing: " + spec);
+        }
+        for (int value = bounds[0]; value <= bounds[1]; value += step) {
+            axis.values.push_back(value);
+        }
+    }
+    else {
+        // List v1,v2,...
+        std::istringstream list(values);
+        std::string value;
+        while (std::getline(list, value, ',')) {
+            axis.values.push_back(parse_int(value, spec));
+        }
+        if (axis.values.empty()) {
+            throw std::invalid_argument("No values in sweep " + spec);
+        }
+    }
+    if (!axis.parameter && std::any_of(axis.values.begin(), axis.values.end(), [](int value) { return value < 0; })) {
+        throw std::invalid_argument("Vehicle portions cannot be negative: " + spec);
+    }
+    m_axes.push_back(axis);
+}
+
+std::vector<SimulationParameters> ParameterSweep::points() const {
+    std::vector<SimulationParameters> points {m_base};
+    for (const auto& axis : m_axes) {
+        std::vector<SimulationParameters> expanded;
+        expanded.reserve(points.size() * axis.values.size());
+        for (const auto& point : points) {
+            for (int value : axis.values) {
+                expanded.push_back(point);
+                if (axis.parameter) {
+                    expanded.back().*axis.parameter = value;
+                }
+                else {
+                    expanded.back().portions[axis.vehicle_class] = value;
+                }
+            }
+        }
+        points = std::move(expanded);
+    }
+    return points;
+}
+
+void ParameterSweep::run(int seconds, uint32_t replications, uint64_t seed,
+                         ThreadPool& pool, std::ostream& output) const {
+    auto grid = points();
+    // Only the running averages of every run are kept
+    std::vector<SummarySink> results(grid.size() * replications);
+    // Simulators are reused by the worker which created them
+    std::vector<std::unique_ptr<TrafficSimulator>> simulators(pool.size());
+
+    for (uint32_t point = 0; point < grid.size(); ++point) {
+        for (uint32_t replica = 0; replica < replications; ++replica) {
+            pool.submit([&, point, replica] {
+                auto& simulator = simulators[ThreadPool::current_worker()];
+                if (!simulator) {
+                    simulator = std::make_unique<TrafficSimulator>(grid[point], StreamKey {seed, replica});
+                    simulator->set_render_interval(0);
+                }
+                else {
+                    simulator->reconfigure(grid[point], StreamKey {seed, replica});
+                }
+                Pacer pacer;
+                simulator->simulate(seconds, pacer, results[point * replications + replica]);
+            });
+        }
+    }
+    pool.wait();
+
+    static const char delim = ';';
+    output << "index" << delim << "replica" << delim << "arrival_interval" << delim << "two_lane_portion" << delim
+           << "max_speed" << delim;
+    for (const auto& name : VehicleClasses::table().names) {
+        output << name << delim;
+    }
+    output << "avg_speed" << delim << "density" << delim << "flux" << '\n';
+    for (uint32_t point = 0; point < grid.size(); ++point) {
+        for (uint32_t replica = 0; replica < replications; ++replica) {
+            const auto& parameters = grid[point];
+            const auto& summary = results[point * replications + replica];
+            output << point << delim << replica + 1 << delim << parameters.arrival_interval << delim
+                   << parameters.left_lane_portion << delim << parameters.max_speed_ms << delim;
+            for (int portion : parameters.portions) {
+                output << portion << delim;
+            }
+            output << summary.avg_speed() << delim << summary.density() << delim << summary.flux() << '\n';
+        }
+    }
+}
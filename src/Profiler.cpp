@@ -0,0 +1,120 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 23-12-2023
+ * @file Profiler.cpp
+ */
+
+#include "include/Profiler.h"
+
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+
+static const char* PHASE_NAMES[] = {"slowdown", "gap", "lane change", "move", "queue", "stats", "snapshot", "other"};
+static const char* COUNTER_NAMES[] = {"rng draws", "gap probes", "lane change attempts", "lane changes",
+                                      "queue inserts", "queue rejections"};
+
+static const char* STAGE_NAMES[] = {"sweep", "queue", "stats", "snapshot", "other"};
+
+std::atomic<bool> Profiler::s_hardware_enabled {false};
+
+void Profiler::set_hardware_counters(bool enabled) {
+    s_hardware_enabled = enabled;
+}
+
+const char* Profiler::tick_unit() {
+#if defined(__x86_64__) || defined(__i386__)
+    return "cycles";
+#else
+    return "ns";
+#endif
+}
+
+void Profiler::reset() {
+    m_ticks.fill(0);
+    m_calls.fill(0);
+    m_counters.fill(0);
+    m_phase = ProfilePhase::Other;
+    m_start = now();
+
+    if (s_hardware_enabled && !m_hardware) {
+        m_hardware = std::make_unique<HardwareCounters>();
+    }
+    if (m_hardware) {
+        for (auto& events : m_stage_events) {
+            events.fill(0);
+        }
+        m_stage = OtherStage;
+        m_stage_start = m_hardware->read();
+    }
+}
+
+void Profiler::enter_stage(Stage stage) {
+    auto values = m_hardware->read();
+    for (size_t e = 0; e < values.size(); ++e) {
+        m_stage_events[m_stage][e] += values[e] - m_stage_start[e];
+    }
+    m_stage_start = values;
+    m_stage = stage;
+}
+
+void Profiler::report(std::ostream& output, uint64_t steps) {
+    enter(ProfilePhase::Other); // Account for the time up to now
+    // Built whole, so the reports of parallel replications do not interleave
+    std::ostringstream table;
+    uint64_t total = std::accumulate(m_ticks.begin(), m_ticks.end(), uint64_t(0));
+    steps = steps > 0 ? steps : 1;
+
+    table << std::fixed << std::setprecision(1);
+    table << std::left << std::setw(22) << "phase" << std::right << std::setw(16) << tick_unit()
+          << std::setw(8) << "%" << std::setw(14) << "per step" << std::setw(14) << "calls" << '\n';
+    for (size_t p = 0; p < m_ticks.size(); ++p) {
+        table << std::left << std::setw(22) << PHASE_NAMES[p] << std::right << std::setw(16) << m_ticks[p]
+              << std::setw(8) << (total > 0 ? 100.0 * m_ticks[p] / total : 0)
+              << std::setw(14) << static_cast<double>(m_ticks[p]) / steps << std::setw(14) << m_calls[p] << '\n';
+    }
+    table << std::left << std::setw(22) << "counter" << std::right << std::setw(16) << "total"
+          << std::setw(8) << "" << std::setw(14) << "per step" << '\n';
+    for (size_t c = 0; c < m_counters.size(); ++c) {
+        table << std::left << std::setw(22) << COUNTER_NAMES[c] << std::right << std::setw(16) << m_counters[c]
+              << std::setw(8) << "" << std::setw(14) << static_cast<double>(m_counters[c]) / steps << '\n';
+    }
+    if (m_hardware) {
+        report_hardware(table, steps);
+    }
+    output << table.str() << std::flush;
+}
+
+void Profiler::report_hardware(std::ostream& output, uint64_t steps) const {
+    if (!m_hardware->available()) {
+        output << "hardware counters unavailable (" << m_hardware->error() << ")\n";
+        return;
+    }
+    output << std::left << std::setw(22) << "stage (per step)" << std::right;
+    for (auto name : HardwareCounters::EVENT_NAMES) {
+        output << std::setw(16) << name;
+    }
+    output << std::setw(8) << "IPC" << '\n';
+    for (size_t stage = 0; stage < STAGE_COUNT; ++stage) {
+        const auto& events = m_stage_events[stage];
+        output << std::left << std::setw(22) << STAGE_NAMES[stage] << std::right;
+        for (size_t e = 0; e < events.size(); ++e) {
+            if (m_hardware->has(static_cast<HardwareCounters::Event>(e))) {
+                output << std::setw(16) << static_cast<double>(events[e]) / steps;
+            }
+            else {
+                output << std::setw(16) << "n/a";
+            }
+        }
+        if (m_hardware->has(HardwareCounters::Cycles) && m_hardware->has(HardwareCounters::Instructions) &&
+            events[HardwareCounters::Cycles] > 0) {
+            output << std::setw(8) << std::setprecision(2)
+                   << static_cast<double>(events[HardwareCounters::Instructions]) / events[HardwareCounters::Cycles]
+                   << std::setprecision(1);
+        }
+        output << '\n';
+    }
+    if (!m_hardware->error().empty()) {
+        output << "not counted: " << m_hardware->error() << '\n';
+    }
+}
@@ -0,0 +1,29 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 30-12-2023
+ * @file RoadBatch.cpp
+ */
+
+#include "include/RoadBatch.h"
+
+RoadBatch::RoadBatch(uint32_t road_len, uint32_t max_speed, uint32_t replicas)
+                     : m_snapshots(true), m_update_rule(UpdateRule::Sequential),
+                     m_max_speed(max_speed / Road::METERS_PER_CELL), m_min_speed(static_cast<uint32_t>(m_max_speed * 0.4)),
+                     m_cell_count(road_len / Road::METERS_PER_CELL), m_replicas(replicas), m_step(0) {
+}
+
+void RoadBatch::set_update_rule(UpdateRule rule) {
+    m_update_rule = rule;
+}
+
+uint32_t RoadBatch::size() const {
+    return m_cell_count;
+}
+
+uint32_t RoadBatch::replicas() const {
+    return m_replicas;
+}
+
+void RoadBatch::set_snapshots(bool enabled) {
+    m_snapshots = enabled;
+}
@@ -0,0 +1,381 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 30-12-2023
+ * @file RoadBitSliced.cpp
+ */
+
+#include "include/RoadBitSliced.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+using Speed = std::array<uint64_t, RoadBitSliced::SPEED_BITS>;
+
+/**
+ * Bits of the uniform numbers compared with the slowdown probability
+ */
+const uint32_t SLOWDOWN_BITS = 32;
+
+/**
+ * Philox blocks reserved for one cell, each of them gives two random words
+ */
+const uint32_t SLOWDOWN_BLOCKS = SLOWDOWN_BITS / 2;
+
+/**
+ * Cells whose speeds are summed up in the narrow accumulator before it is added to the counters,
+ * the sum of their speeds fits into its planes
+ */
+const uint32_t FLUSH_CELLS = 32;
+
+/**
+ * Narrow vertical accumulator of the speeds
+ */
+using SpeedSum = std::array<uint64_t, 8>;
+
+/**
+ * Replications whose speed is the value
+ */
+uint64_t equal(const Speed& speed, uint32_t value) {
+    uint64_t result = ~0ull;
+    for (uint32_t bit = 0; bit < speed.size(); ++bit) {
+        result &= (value >> bit) & 1 ? speed[bit] : ~speed[bit];
+    }
+    return result;
+}
+
+/**
+ * Replications whose speed is greater than the value, compared from the top bit
+ */
+uint64_t greater(const Speed& speed, uint32_t value) {
+    uint64_t result = 0;
+    uint64_t same = ~0ull;
+    for (uint32_t bit = speed.size(); bit-- > 0;) {
+        if ((value >> bit) & 1) {
+            same &= speed[bit];
+        }
+        else {
+            result |= same & speed[bit];
+            same &= ~speed[bit];
+        }
+    }
+    return result;
+}
+
+/**
+ * Add one to the speed of the replications in the mask
+ */
+void increment(Speed& speed, uint64_t mask) {
+    for (auto& plane : speed) {
+        uint64_t carry = plane & mask;
+        plane ^= mask;
+        mask = carry;
+    }
+}
+
+/**
+ * Subtract one from the speed of the replications in the mask
+ */
+void decrement(Speed& speed, uint64_t mask) {
+    for (auto& plane : speed) {
+        uint64_t borrow = ~plane & mask;
+        plane ^= mask;
+        mask = borrow;
+    }
+}
+
+/**
+ * Lower the speed to the limit where it is greater, both are compared from the top bit
+ */
+void limit(Speed& speed, const Speed& limit) {
+    uint64_t greater = 0;
+    uint64_t same = ~0ull;
+    for (uint32_t bit = speed.size(); bit-- > 0;) {
+        greater |= same & speed[bit] & ~limit[bit];
+        same &= ~(speed[bit] ^ limit[bit]);
+    }
+    for (uint32_t bit = 0; bit < speed.size(); ++bit) {
+        speed[bit] = (speed[bit] & ~greater) | (limit[bit] & greater);
+    }
+}
+
+/**
+ * Replications with every speed from 0 to MAX_SPEED, from the pairs of the lower bits
+ */
+template <uint32_t MAX_SPEED>
+void decode(const Speed& speed, std::array<uint64_t, MAX_SPEED + 1>& hot) {
+    uint64_t low[4] = {~speed[0] & ~speed[1], speed[0] & ~speed[1], ~speed[0] & speed[1], speed[0] & speed[1]};
+    for (uint32_t value = 0; value <= MAX_SPEED; ++value) {
+        hot[value] = low[value & 3] & (value & 4 ? speed[2] : ~speed[2]);
+    }
+}
+
+/**
+ * Add the speed to the accumulator by a ripple carry adder, all replications at once
+ */
+void add_speed(SpeedSum& sum, const Speed& speed) {
+    uint64_t carry = 0;
+    for (uint32_t plane = 0; plane < sum.size(); ++plane) {
+        uint64_t addend = plane < speed.size() ? speed[plane] : 0;
+        uint64_t half = sum[plane] ^ addend;
+        uint64_t next_carry = (sum[plane] & addend) | (half & carry);
+        sum[plane] = half ^ carry;
+        carry = next_carry;
+    }
+}
+
+} // namespace
+
+uint32_t RoadBitSliced::Counters::value(uint32_t road) const {
+    uint32_t value = 0;
+    for (uint32_t plane = 0; plane < planes.size(); ++plane) {
+        value |= static_cast<uint32_t>((planes[plane] >> road) & 1) << plane;
+    }
+    return value;
+}
+
+RoadBitSliced::RoadBitSliced(uint32_t road_len, uint32_t max_speed, uint64_t seed, uint32_t first_replica, uint32_t replicas)
+                             : RoadBatch(road_len, max_speed, replicas),
+                             m_slowdown_gen(StreamKey {seed, first_replica}, RandomStream::Slowdown) {
+    if (replicas == 0 || replicas > WIDTH) {
+        throw std::invalid_argument("A bitsliced road holds 1 to " + std::to_string(WIDTH) + " replications");
+    }
+    if (m_max_speed == 0 || m_max_speed >= (1u << SPEED_BITS)) {
+        throw std::invalid_argument("The bitsliced engine needs a maximal speed of 1 to " +
+                                    std::to_string(((1u << SPEED_BITS) - 1) * Road::METERS_PER_CELL) + " m/s");
+    }
+    m_update_rule = UpdateRule::Synchronous;
+    m_cells.assign(m_cell_count + PADDING, Cell {});
+    m_next.assign(m_cell_count + PADDING, Cell {});
+    m_num_vehicles.fill(0);
+    m_queues.assign(m_replicas, RingBuffer<uint8_t>(Road::QUEUE_CAPACITY, 0));
+    // Same probability as a draw from 0 to 99 up to the deceleration threshold
+    m_slowdown_threshold = static_cast<uint64_t>(std::llround(std::min((Road::RAND_DEC_TH + 1) / 100.0, 1.0) * (1ull << SLOWDOWN_BITS)));
+}
+
+template <uint32_t MAX_SPEED>
+void RoadBitSliced::sweep() {
+    uint32_t min_speed = std::max(m_min_speed, 1u);
+    SpeedSum speed_sum {};
+    for (uint32_t cell = 0; cell < m_cell_count; ++cell) {
+        if (cell % FLUSH_CELLS == FLUSH_CELLS - 1) {
+            for (uint32_t plane = 0; plane < speed_sum.size(); ++plane) {
+                m_speed_sum.add(speed_sum[plane], plane);
+            }
+            speed_sum = {};
+        }
+        uint64_t occupied = m_cells[cell].occupied;
+        if (occupied == 0) {
+            continue;
+        }
+        Speed speed = m_cells[cell].speed;
+
+        // Step 1: Random acceleration / deceleration by one cell per second
+        PROFILE_PHASE(Slowdown);
+        uint64_t slow = slowdown_mask(cell, occupied);
+        increment(speed, occupied & ~slow & ~equal(speed, MAX_SPEED));
+        decrement(speed, slow & greater(speed, min_speed - 1));
+
+        // Step 2: Limit the speed by the free cells in front of the car before the step,
+        // the padding behind the end of the road is always free.
+        // The gap becomes every distance up to which the cells are still free
+        PROFILE_PHASE(Gap);
+        Speed gap {};
+        uint64_t free_run = ~0ull;
+        for (uint32_t distance = 1; distance <= MAX_SPEED; ++distance) {
+            free_run &= ~m_cells[cell + distance].occupied;
+            for (uint32_t bit = 0; bit < SPEED_BITS; ++bit) {
+                gap[bit] = (distance >> bit) & 1 ? gap[bit] | free_run : gap[bit] & ~free_run;
+            }
+        }
+        limit(speed, gap);
+
+        // Step 3: Move the cars by their speed, the ones which leave the road land in the padding
+        PROFILE_PHASE(Move);
+        std::array<uint64_t, MAX_SPEED + 1> moving_by;
+        decode<MAX_SPEED>(speed, moving_by);
+        moving_by[0] &= occupied;
+        for (uint32_t distance = 0; distance <= MAX_SPEED; ++distance) {
+            uint64_t moving = moving_by[distance];
+            auto& target = m_next[cell + distance];
+            target.occupied |= moving;
+            for (uint32_t bit = 0; bit < SPEED_BITS; ++bit) {
+                if ((distance >> bit) & 1) {
+                    target.speed[bit] |= moving;
+                }
+            }
+        }
+        add_speed(speed_sum, speed);
+    }
+    for (uint32_t plane = 0; plane < speed_sum.size(); ++plane) {
+        m_speed_sum.add(speed_sum[plane], plane);
+    }
+}
+
+void RoadBitSliced::update(std::vector<TrafficDataSample>& stats) {
+    m_speed_sum.clear();
+    std::fill(m_next.begin(), m_next.end(), Cell {});
+    // The loops of the sweep are unrolled for every maximal speed
+    switch (m_max_speed) {
+        case 1:
+            sweep<1>();
+            break;
+        case 2:
+            sweep<2>();
+            break;
+        case 3:
+            sweep<3>();
+            break;
+        case 4:
+            sweep<4>();
+            break;
+        case 5:
+            sweep<5>();
+            break;
+        case 6:
+            sweep<6>();
+            break;
+        default:
+            sweep<7>();
+    }
+
+    // The cars moved into the padding left the road
+    PROFILE_PHASE(Stats);
+    stats.resize(m_replicas);
+    for (uint32_t road = 0; road < m_replicas; ++road) {
+        auto& sample = stats[road];
+        uint32_t flux = 0;
+        uint32_t leaving_speed = 0;
+        for (uint32_t cell = m_cell_count; cell < m_next.size(); ++cell) {
+            if (occupied(m_next[cell], road)) {
+                flux++;
+                leaving_speed += speed(m_next[cell], road);
+            }
+        }
+        m_num_vehicles[road] -= flux;
+        sample.flux = flux;
+        sample.avg_speed = m_speed_sum.value(road) - leaving_speed;
+    }
+    std::fill(m_next.begin() + m_cell_count, m_next.end(), Cell {});
+    std::swap(m_cells, m_next);
+
+    for (uint32_t road = 0; road < m_replicas; ++road) {
+        auto& sample = stats[road];
+        uint32_t speed_sum = sample.avg_speed;
+
+        PROFILE_PHASE(Queue);
+        auto& queue = m_queues[road];
+        if (!queue.empty()) {
+            if (entry_free(road)) {
+                PROFILE_COUNT(QueueInserts);
+                place_at_entry(road, queue.front());
+                speed_sum += queue.front();
+                queue.pop();
+            }
+            else {
+                PROFILE_COUNT(QueueRejections);
+            }
+        }
+        PROFILE_PHASE(Stats);
+        uint32_t num_vehicles = m_num_vehicles[road];
+        sample.avg_speed = num_vehicles > 0 ? speed_sum / static_cast<float>(num_vehicles) : 0;
+        sample.density = num_vehicles / static_cast<float>(m_cell_count);
+        if (m_snapshots) {
+            PROFILE_PHASE(Snapshot);
+            sample.road_snapshot.resize(1);
+            to_str(road, sample.road_snapshot[RIGHT_LANE]);
+        }
+        else {
+            sample.road_snapshot.clear();
+        }
+    }
+    PROFILE_PHASE(Other);
+    m_step++;
+}
+
+uint64_t RoadBitSliced::slowdown_mask(uint32_t cell, uint64_t cars) const {
+    if (m_slowdown_threshold >> SLOWDOWN_BITS) {
+        return cars;
+    }
+    // Every car compares a uniform number with the threshold from the top bit down, the random words
+    // give the next bit of all the numbers. A car is decided by the first bit which differs
+    // from the threshold, so only a few words are needed until all cars of the cell are.
+    uint64_t below = 0;
+    uint64_t undecided = cars;
+    for (uint32_t word = 0; undecided != 0 && word < SLOWDOWN_BITS; word += 4) {
+        // Two independent blocks at once, their rounds overlap
+        PROFILE_COUNT(RngDraws);
+        PROFILE_COUNT(RngDraws);
+        auto first = m_slowdown_gen.block(cell * SLOWDOWN_BLOCKS + word / 2, m_step);
+        auto second = m_slowdown_gen.block(cell * SLOWDOWN_BLOCKS + word / 2 + 1, m_step);
+        uint64_t random[4] = {first[0] | static_cast<uint64_t>(first[1]) << 32, first[2] | static_cast<uint64_t>(first[3]) << 32,
+                              second[0] | static_cast<uint64_t>(second[1]) << 32, second[2] | static_cast<uint64_t>(second[3]) << 32};
+        for (uint32_t k = 0; k < 4; ++k) {
+            if ((m_slowdown_threshold >> (SLOWDOWN_BITS - 1 - word - k)) & 1) {
+                below |= undecided & ~random[k];
+                undecided &= random[k];
+            }
+            else {
+                undecided &= ~random[k];
+            }
+        }
+    }
+    return below;
+}
+
+uint8_t RoadBitSliced::speed(const Cell& cell, uint32_t road) {
+    uint8_t speed = 0;
+    for (uint32_t bit = 0; bit < SPEED_BITS; ++bit) {
+        speed |= ((cell.speed[bit] >> road) & 1) << bit;
+    }
+    return speed;
+}
+
+void RoadBitSliced::insert(uint32_t road, Vehicle vehicle) {
+    if (vehicle.get_vehicle_type() != vt_t::car) {
+        throw std::invalid_argument("The bitsliced engine simulates cars only");
+    }
+    uint8_t speed = std::clamp<uint8_t>(vehicle.get_speed(), m_min_speed, m_max_speed);
+    if (!entry_free(road)) {
+        PROFILE_COUNT(QueueRejections);
+        m_queues[road].push(speed);
+        return;
+    }
+    PROFILE_COUNT(QueueInserts);
+    place_at_entry(road, speed);
+}
+
+bool RoadBitSliced::entry_free(uint32_t road) const {
+    // Same as Road::entry_free for a car under the synchronous rule, only other cars can reach into the entry
+    return m_cell_count > 3 && !occupied(m_cells[0], road) && !occupied(m_cells[1], road);
+}
+
+void RoadBitSliced::place_at_entry(uint32_t road, uint8_t speed) {
+    uint64_t bit = 1ull << road;
+    m_num_vehicles[road]++;
+    m_cells[0].occupied |= bit;
+    for (uint32_t plane = 0; plane < SPEED_BITS; ++plane) {
+        m_cells[0].speed[plane] = (m_cells[0].speed[plane] & ~bit) | ((speed >> plane) & 1 ? bit : 0);
+    }
+}
+
+void RoadBitSliced::to_str(uint32_t road, std::string& road_string) const {
+    road_string.clear();
+    for (uint32_t cell = 0; cell < m_cell_count; ++cell) {
+        if (occupied(m_cells[cell], road)) {
+            Vehicle(vt_t::car, speed(m_cells[cell], road)).append_str(road_string);
+        }
+        else {
+            road_string += '.';
+        }
+    }
+}
+
+void RoadBitSliced::set_update_rule(UpdateRule rule) {
+    if (rule != UpdateRule::Synchronous) {
+        throw std::invalid_argument("The bitsliced engine implements only the synchronous update rule");
+    }
+    m_update_rule = rule;
+}
@@ -7,53 +7,53 @@
 #include "include/RoadMap.h"
 
 #include <algorithm>
-#include <random>
+#include <stdexcept>
+#include <type_traits>
 
-Road::Road(uint32_t road_len, uint32_t max_speed) : m_max_speed(max_speed / METERS_PER_CELL), m_min_speed(static_cast<uint32_t>(m_max_speed * 0.4)), m_cell_count(road_len / METERS_PER_CELL) {
-    std::random_device rd;
-    m_gen = std::mt19937(rd());
-    m_queue = {};
-    m_road = std::vector<std::vector<std::optional<Vehicle>>>();
+Road::Road(uint32_t road_len, uint32_t max_speed, StreamKey key) : m_snapshots(true), m_update_rule(UpdateRule::Sequential), m_max_speed(max_speed / METERS_PER_CELL), m_min_speed(static_cast<uint32_t>(m_max_speed * 0.4)), m_cell_count(road_len / METERS_PER_CELL),
+                                                                 m_queue(QUEUE_CAPACITY, Vehicle(vt_t::car)), m_slowdown_gen(key, RandomStream::Slowdown), m_overtake_gen(key, RandomStream::Overtaking), m_step(0) {
+    m_road = std::vector<Lane>();
 }
 
-bool Road::lane_free_check(uint32_t position, uint8_t lane, uint8_t vehicle_length) {
-    if (position >= m_road[lane].size()) {
-        return false;
-    }
-    if (m_road[lane][position].has_value()) {
-        return false;
-    }
-    // STEP 1: Check for car in front
+bool Road::lane_free_check(uint32_t position, uint8_t lane, uint8_t vehicle_length) const {
+    PROFILE_COUNT(GapProbes);
     // Check road length boundaries
-    if (position + 1 >= m_cell_count) {
+    if (position + 2 >= m_cell_count) {
         return false;
     }
     // Check if vehicle in front of this, by 1 has length bigger than 1
+    // or vehicle in front of this, by 2 places has length bigger than 2
     // _______C________
     // _______BB_______
-    if (m_road[lane][position + 1].has_value() && m_road[lane][position + 1].value().Length > 1) {
-        return false;
-    }
-    // Check road length boundaries
-    if (position + 2 >= m_cell_count) {
-        return false;
-    }
-    // Check if vehicle in front of this, by 2 places has length bigger than 2
-    if (m_road[lane][position + 2].has_value() && m_road[lane][position + 2].value().Length > 2) {
+    if (m_road[lane].reaches_back(position + 1, 1) || m_road[lane].reaches_back(position + 2, 2)) {
         return false;
     }
+    // Check the cells of this vehicle and for a car behind (if length of this vehicle is greater than 1)
+    uint32_t rear = position >= vehicle_length ? position - vehicle_length + 1 : 0;
+    return !m_road[lane].any_occupied(rear, position);
+}
 
-    // Check for a car behind (if length of this vehicle is greater than 1)
-    if (vehicle_length == 1) {
-        return true;
+void Road::set_snapshots(bool enabled) {
+    m_snapshots = enabled;
+}
+
+void Road::set_update_rule(UpdateRule rule) {
+    m_update_rule = rule;
+    if (rule == UpdateRule::Synchronous && m_next.size() != m_road.size()) {
+        m_next.assign(m_road.size(), Lane(m_cell_count));
     }
-    for (int i = 1; i < vehicle_length && static_cast<int>(position) - i >= 0; ++i) {
-        if (m_road[lane][position - i].has_value()) {
-            return false;
-        }
+}
+
+void Road::reset(uint32_t max_speed, uint8_t, StreamKey key) {
+    m_max_speed = max_speed / METERS_PER_CELL;
+    m_min_speed = static_cast<uint32_t>(m_max_speed * 0.4);
+    for (auto& lane : m_road) {
+        lane.reset();
     }
-    // Now lane switch is surely possible
-    return true;
+    m_queue.clear();
+    m_slowdown_gen = Philox(key, RandomStream::Slowdown);
+    m_overtake_gen = Philox(key, RandomStream::Overtaking);
+    m_step = 0;
 }
 
 void Road::insert(Vehicle vehicle) {
@@ -63,13 +63,13 @@ void Road::insert(Vehicle vehicle) {
     else if (vehicle.get_speed() > m_max_speed) {
         vehicle.set_speed(m_max_speed);
     }
-    for (uint8_t i = 0; i < vehicle.Length; ++i) {
-        if (!lane_free_check(i, RIGHT_LANE, vehicle.Length)) {
-            m_queue.push(vehicle);
-            return; // Place for vehicle is already occupied
-        }
+    if (!entry_free(entry_length(vehicle))) {
+        PROFILE_COUNT(QueueRejections);
+        m_queue.push(vehicle);
+        return; // Place for vehicle is already occupied
     }
-    m_road[RIGHT_LANE][vehicle.Length - 1] = vehicle;
+    PROFILE_COUNT(QueueInserts);
+    place_at_entry(vehicle);
 }
 
 int32_t Road::insert_vehicle_from_queue() {
@@ -77,252 +77,502 @@ int32_t Road::insert_vehicle_from_queue() {
         return false;
     }
     auto vehicle = m_queue.front();
-    for(int i = 0; i < vehicle.Length; ++i) {
-        if (!lane_free_check(i, RIGHT_LANE, vehicle.Length)) {
-            return -1;
-        }
+    if (!entry_free(entry_length(vehicle))) {
+        PROFILE_COUNT(QueueRejections);
+        return -1;
     }
-    m_road[RIGHT_LANE][vehicle.Length - 1] = vehicle;
+    PROFILE_COUNT(QueueInserts);
+    place_at_entry(vehicle);
     m_queue.pop();
-    return vehicle.Length - 1;
+    return vehicle.length() - 1;
+}
+
+bool Road::entry_free(uint8_t vehicle_length) {
+    for (uint8_t i = 0; i < vehicle_length; ++i) {
+        if (!lane_free_check(i, RIGHT_LANE, vehicle_length)) {
+            return false;
+        }
+    }
+    return true;
 }
 
-std::string Road::to_str(uint8_t lane) const {
-    return Road::to_str(lane, 0);
+void Road::place_at_entry(const Vehicle& vehicle) {
+    m_road[RIGHT_LANE].set(vehicle.length() - 1, vehicle);
+}
+
+std::string Road::to_str() const {
+    std::string road_string {};
+    to_str(road_string);
+    return road_string;
 }
 
-std::string Road::to_str(uint8_t lane, uint32_t lane_start) const {
-    std::string road_string {""};
+void Road::lane_to_str(uint8_t lane, uint32_t lane_start, std::string& road_string) const {
+    size_t begin = road_string.size();
     for (int32_t i = m_road[lane].size() - 1; i >= 0; --i) {
         if (static_cast<uint32_t>(i) < lane_start) {
             road_string += '#';
             continue;
         }
-        if (!m_road[lane][i].has_value()) {
+        if (!m_road[lane].occupied(i)) {
             road_string += '.';
         }
         else {
-            auto vehicle = m_road[lane][i].value();
-            switch (vehicle.get_vehicle_type()) {
-                case vt_t::car:
-                    break;
-                case vt_t::bus:
-                    i -= 1;
-                    break;
-                case vt_t::truck:
-                    i -= 2;
-                    break;
-            }
-            road_string += vehicle.to_str();
+            auto vehicle = m_road[lane].get(i);
+            i -= vehicle.length() - 1;
+            vehicle.append_str(road_string);
         }
     }
-    std::reverse(road_string.begin(), road_string.end());
-    return road_string;
+    std::reverse(road_string.begin() + begin, road_string.end());
 }
 
-RoadMap::RoadMap(uint32_t road_len, uint32_t max_speed) : Road(road_len, max_speed) {
-    m_road.emplace_back(m_cell_count, std::nullopt);
+void Road::record(uint8_t lane, uint32_t space_stride, uint8_t* row) const {
+    Road::record(lane, 0, space_stride, row);
 }
 
-TrafficDataSample RoadMap::update() {
-    TrafficDataSample stats {};
-    uint32_t num_vehicles = 0;
-    uint32_t num_occupied_spaces = 0;
-
-    for (int32_t i = m_road[RIGHT_LANE].size() - 1; i >= 0; --i) {
-        if (!m_road[RIGHT_LANE][i].has_value()) {
-            continue;
+void Road::record(uint8_t lane, uint32_t lane_start, uint32_t space_stride, uint8_t* row) const {
+    const auto& cells = m_road[lane];
+    for (uint32_t i = 0; i < cells.size(); i += space_stride) {
+        if (i < lane_start) {
+            *row++ = CELL_NO_LANE;
         }
-        // Take vehicle of the road
-        auto vehicle = *(m_road[RIGHT_LANE][i]);
-        m_road[RIGHT_LANE][i].reset();
-
-        // Step 1: Random acceleration / deceleration
-        if (m_gen() % 100 > RAND_DEC_TH) {
-            if (vehicle.get_speed() < m_max_speed) {
-                vehicle.accelerate();
-            }
+        else if (cells.occupied(i)) {
+            auto vehicle = cells.get(i);
+            *row++ = cell_code(vehicle.get_vehicle_type(), vehicle.get_speed());
+        }
+        else if ((i + 1 < cells.size() && cells.reaches_back(i + 1, 1)) ||
+                 (i + 2 < cells.size() && cells.reaches_back(i + 2, 2))) {
+            *row++ = CELL_BODY;
         }
         else {
-            if (vehicle.get_speed() >= m_min_speed) {
-                vehicle.decelerate();
-            }
+            *row++ = CELL_EMPTY;
         }
+    }
+}
 
-        // Step 2: Check driving distance
-        auto driving_distance = get_driving_distance(i);
-        if (vehicle.get_speed() > driving_distance) {
-            vehicle.set_speed(driving_distance);
-        }
+void Road::reset_leaders() {
+    m_leader.assign(m_road.size(), INT32_MAX);
+}
 
-        // Step 3: Place the vehicle at a new position, if new position is still in scope
-        uint32_t vehicle_new_pos = i + vehicle.get_speed();
-        if (vehicle_new_pos < m_road[RIGHT_LANE].size()) {
-            // Collect data about the vehicle
-            num_vehicles += 1;
-            num_occupied_spaces += vehicle.Length;
-            stats.avg_speed += vehicle.get_speed();
+void Road::place(uint8_t lane, uint32_t position, const Vehicle& vehicle) {
+    m_road[lane].set(position, vehicle);
+    m_leader[lane] = std::min(m_leader[lane], static_cast<int32_t>(position));
+}
 
-            m_road[RIGHT_LANE][vehicle_new_pos] = vehicle;
-        }
-        else {
-            // Vehicle left the road in the current time step
-            stats.flux += 1;
+Vehicle Road::take(uint8_t lane, uint32_t position) {
+    auto vehicle = m_road[lane].get(position);
+    m_road[lane].clear(position);
+    if (m_leader[lane] == static_cast<int32_t>(position)) {
+        // Everything in front of the swept position has been placed already
+        m_leader[lane] = m_road[lane].next_occupied(position);
+    }
+    return vehicle;
+}
+
+uint32_t Road::drive(Vehicle& vehicle, uint32_t position, int32_t leader, uint8_t leader_length) {
+    if (leader != INT32_MAX) {
+        int32_t driving_distance = leader - static_cast<int32_t>(position) - leader_length;
+        if (vehicle.get_speed() > driving_distance) {
+            vehicle.set_speed(driving_distance);
         }
     }
+    return position + vehicle.get_speed();
+}
+
+void Road::finish_update(TrafficDataSample& stats, uint32_t num_vehicles, uint32_t num_occupied_spaces, uint32_t left_lane_begin) {
+    PROFILE_PHASE(Queue);
     auto new_vehicle_pos = insert_vehicle_from_queue();
+    PROFILE_PHASE(Stats);
     if (new_vehicle_pos >= 0) {
-        if (m_road[RIGHT_LANE][new_vehicle_pos].has_value()){
-            auto vehicle = m_road[RIGHT_LANE][new_vehicle_pos].value();
+        if (m_road[RIGHT_LANE].occupied(new_vehicle_pos)){
+            auto vehicle = m_road[RIGHT_LANE].get(new_vehicle_pos);
             num_vehicles++;
-            num_occupied_spaces += vehicle.Length;
+            num_occupied_spaces += vehicle.length();
             stats.avg_speed += vehicle.get_speed();
         }
     }
+    uint32_t cells = m_cell_count + (m_road.size() > 1 ? m_cell_count - left_lane_begin : 0);
     stats.avg_speed = num_vehicles > 0 ? stats.avg_speed / num_vehicles : 0;
-    stats.density = num_occupied_spaces / static_cast<float>(m_road[RIGHT_LANE].size());
-    stats.road_snapshot = {this->to_str()};
-    return stats;
-}
-
-std::string RoadMap::to_str() const {
-    return Road::to_str(RIGHT_LANE);
-}
-
-int32_t RoadMap::get_driving_distance(int32_t from) {
-    for (uint32_t i = from; i < m_road[RIGHT_LANE].size(); ++i) {
-        if (m_road[RIGHT_LANE][i].has_value()) {
-            return i - from - m_road[RIGHT_LANE][i].value().Length;
+    stats.density = num_occupied_spaces / static_cast<float>(cells);
+    if (m_snapshots) {
+        PROFILE_PHASE(Snapshot);
+        stats.road_snapshot.resize(m_road.size());
+        for (uint8_t lane = 0; lane < m_road.size(); ++lane) {
+            stats.road_snapshot[lane].clear();
+            lane_to_str(lane, lane == LEFT_LANE ? left_lane_begin : 0, stats.road_snapshot[lane]);
         }
     }
-    return INT32_MAX;
+    else {
+        stats.road_snapshot.clear();
+    }
+    PROFILE_PHASE(Other);
+    m_step++;
 }
 
-uint32_t RoadMap::size() const {
-    return m_road[RIGHT_LANE].size();
+template <uint8_t LANES, UpdateRule RULE, class Vehicles, class Slowdown>
+RoadCells<LANES, RULE, Vehicles, Slowdown>::RoadCells(uint32_t road_len, uint32_t max_speed, uint8_t two_lane_portion, StreamKey key)
+        : Road(road_len, max_speed, key), m_left_lane_begin(static_cast<int>((100 - two_lane_portion) / 100.f * m_cell_count)) {
+    for (uint8_t lane = 0; lane < LANES; ++lane) {
+        m_road.emplace_back(m_cell_count);
+    }
+    Road::set_update_rule(RULE);
 }
 
-RoadMapTwoLane::RoadMapTwoLane(uint32_t road_len, uint32_t max_speed, uint8_t two_lane_portion) : Road(road_len, max_speed) {
-    m_road.emplace_back(m_cell_count, std::nullopt);
-    m_road.emplace_back(m_cell_count, std::nullopt);
+template <uint8_t LANES, UpdateRule RULE, class Vehicles, class Slowdown>
+void RoadCells<LANES, RULE, Vehicles, Slowdown>::reset(uint32_t max_speed, uint8_t two_lane_portion, StreamKey key) {
+    Road::reset(max_speed, two_lane_portion, key);
     m_left_lane_begin = static_cast<int>((100 - two_lane_portion) / 100.f * m_cell_count);
+}
 
+template <uint8_t LANES, UpdateRule RULE, class Vehicles, class Slowdown>
+void RoadCells<LANES, RULE, Vehicles, Slowdown>::set_update_rule(UpdateRule rule) {
+    if (rule != RULE) {
+        throw std::invalid_argument("The road is specialised for the " + std::string(RULE == UpdateRule::Synchronous ? "synchronous" : "sequential") + " rule");
+    }
+}
+
+template <uint8_t LANES, UpdateRule RULE, class Vehicles, class Slowdown>
+void RoadCells<LANES, RULE, Vehicles, Slowdown>::update(TrafficDataSample& stats) {
+    if constexpr (RULE == UpdateRule::Synchronous) {
+        update_synchronous(stats);
+    }
+    else {
+        update_sequential(stats);
+    }
 }
 
-TrafficDataSample RoadMapTwoLane::update() {
-    TrafficDataSample stats {};
+template <uint8_t LANES, UpdateRule RULE, class Vehicles, class Slowdown>
+void RoadCells<LANES, RULE, Vehicles, Slowdown>::update_sequential(TrafficDataSample& stats) {
+    stats.avg_speed = 0;
+    stats.flux = 0;
     uint32_t num_vehicles = 0;
     uint32_t num_occupied_spaces = 0;
+    reset_leaders();
 
-    uint32_t vehicle_new_pos;
-    uint8_t vehicle_new_lane;
-
-    for (int32_t x = m_cell_count - 1; x >= 0; --x) {
-        for (int8_t l = 1; l >= 0; --l){
-            if (!m_road[l][x].has_value()) {
+    for (int32_t x = prev_occupied(m_cell_count - 1); x >= 0; x = prev_occupied(x - 1)) {
+        for (int8_t l = LANES - 1; l >= 0; --l) {
+            if (LANES > 1 && !m_road[l].occupied(x)) {
                 continue;
             }
-            // Take vehicle of the road and alter it
-            auto vehicle = *(m_road[l][x]);
-            m_road[l][x].reset();
+            // Take vehicle of the road
+            PROFILE_PHASE(Move);
+            auto vehicle = take(l, x);
 
             // Step 1: Random acceleration / deceleration
-            if (l == LEFT_LANE || vehicle.get_speed() <= m_min_speed || m_gen() % 100 > RAND_DEC_TH) {
-                if (vehicle.get_speed() < m_max_speed) {
-                    vehicle.accelerate();
-                }
-            }
-            else {
-                vehicle.decelerate();
-            }
+            PROFILE_PHASE(Slowdown);
+            slow_down(vehicle, l, x);
 
             // Step 2: Check driving distances and overtaking opportunities
-            if (l == LEFT_LANE) { // Left lane code
-                auto driving_distance_left = get_driving_distance(x, LEFT_LANE);
+            PROFILE_PHASE(Gap);
+            uint8_t vehicle_new_lane = l;
+            uint32_t vehicle_new_pos;
+            if (LANES > 1 && l == LEFT_LANE) {
+                auto driving_distance_left = driving_distance(x, LEFT_LANE);
                 if (vehicle.get_speed() > driving_distance_left) {
                     vehicle.set_speed(driving_distance_left);
                 }
                 vehicle_new_pos = x + vehicle.get_speed();
-                if (lane_free_check(vehicle_new_pos, RIGHT_LANE, vehicle.Length)) {
-                    vehicle_new_lane = RIGHT_LANE; // Switch lane if possible
-                }
-                else {
-                    vehicle_new_lane = LEFT_LANE; // Stay in the left lane if right lane is occupied
-                }
-            } // Left lane
-
-            else { // Right lane code
-                // Lane switch condition
-                // If left lane started
-                // If faster than vehicle in front
-                // If overtake wanted
-                // If the distance in the left lane is bigger than the distance in right lane
-                if (static_cast<uint32_t>(x) > m_left_lane_begin &&
-                    vehicle.get_speed() > get_driving_distance(x, RIGHT_LANE) &&
-                    m_gen() % 100 < RAND_OVERTAKE_TH &&
-                    get_driving_distance(x, LEFT_LANE) > get_driving_distance(x, RIGHT_LANE)
-                                ) { // Overtake
-                    vehicle_new_lane = LEFT_LANE;
-                }
-                else { // Don't overtake
+                // Switch back to the right lane if possible
+                PROFILE_PHASE(LaneChange);
+                PROFILE_COUNT(LaneChangeAttempts);
+                if (lane_free(vehicle_new_pos, RIGHT_LANE, Vehicles::length(vehicle))) {
+                    PROFILE_COUNT(LaneChanges);
                     vehicle_new_lane = RIGHT_LANE;
                 }
-                // Check driving distance
-                if (vehicle.get_speed() > get_driving_distance(x, vehicle_new_lane)) {
-                    vehicle.set_speed(get_driving_distance(x, vehicle_new_lane));
+            }
+            else {
+                if (LANES > 1) {
+                    PROFILE_PHASE(LaneChange);
+                    if (overtakes(vehicle, x, [this](uint32_t from, uint8_t lane) { return driving_distance(from, lane); })) {
+                        PROFILE_COUNT(LaneChanges);
+                        vehicle_new_lane = LEFT_LANE;
+                    }
+                    PROFILE_PHASE(Gap);
+                }
+                auto distance = driving_distance(x, vehicle_new_lane);
+                if (vehicle.get_speed() > distance) {
+                    vehicle.set_speed(distance);
                 }
                 vehicle_new_pos = x + vehicle.get_speed();
             }
 
-            // Step 3: Place the vehicle
+            // Step 3: Place the vehicle at a new position, if new position is still in scope
+            PROFILE_PHASE(Move);
             if (vehicle_new_pos < m_cell_count) {
+                // Collect data about the vehicle
                 num_vehicles += 1;
-                num_occupied_spaces += vehicle.Length;
+                num_occupied_spaces += Vehicles::length(vehicle);
                 stats.avg_speed += vehicle.get_speed();
-                m_road[vehicle_new_lane][vehicle_new_pos] = vehicle;
+                place(vehicle_new_lane, vehicle_new_pos, vehicle);
             }
             else {
+                // Vehicle left the road in the current time step
                 stats.flux += 1;
             }
-        } // Lane update
-    } // Update step
-    auto new_vehicle_pos = insert_vehicle_from_queue();
-    if (new_vehicle_pos >= 0) {
-        if (m_road[RIGHT_LANE][new_vehicle_pos].has_value()){
-            auto vehicle = m_road[RIGHT_LANE][new_vehicle_pos].value();
-            num_vehicles++;
-            num_occupied_spaces += vehicle.Length;
+        }
+    }
+    finish_update(stats, num_vehicles, num_occupied_spaces, m_left_lane_begin);
+}
+
+template <uint8_t LANES, UpdateRule RULE, class Vehicles, class Slowdown>
+void RoadCells<LANES, RULE, Vehicles, Slowdown>::update_synchronous(TrafficDataSample& stats) {
+    stats.avg_speed = 0;
+    stats.flux = 0;
+    uint32_t num_vehicles = 0;
+    uint32_t num_occupied_spaces = 0;
+
+    if constexpr (LANES == 1) {
+        auto& next = m_next[RIGHT_LANE];
+        next.reset();
+        advance<true>(m_road[RIGHT_LANE], RIGHT_LANE, next, stats, num_vehicles, num_occupied_spaces);
+        std::swap(m_road[RIGHT_LANE], next);
+    }
+    else {
+        // Sub-step 1: Random acceleration / deceleration and lane changes, from the road into the next lanes
+        // Vehicles entering a lane all come from the other one and the cells they enter were free,
+        // so the lane changes cannot collide
+        for (auto& lane : m_next) {
+            lane.reset();
+        }
+        for (int8_t l = 1; l >= 0; --l) {
+            const auto& lane = m_road[l];
+            for (int32_t x = lane.prev_occupied(m_cell_count - 1); x >= 0; x = lane.prev_occupied(x - 1)) {
+                PROFILE_PHASE(Move);
+                auto vehicle = lane.get(x);
+
+                // Step 1: Random acceleration / deceleration
+                PROFILE_PHASE(Slowdown);
+                slow_down(vehicle, l, x);
+
+                // Step 2: Lane change, the same conditions as the sequential rule checked at the current position
+                PROFILE_PHASE(LaneChange);
+                uint8_t vehicle_new_lane = l;
+                if (l == LEFT_LANE) {
+                    PROFILE_COUNT(LaneChangeAttempts);
+                    if (lane_free(x, RIGHT_LANE, Vehicles::length(vehicle))) {
+                        vehicle_new_lane = RIGHT_LANE;
+                    }
+                }
+                else if (overtakes(vehicle, x, [this](uint32_t from, uint8_t lane_index) { return lane_gap(m_road[lane_index], from, lane_index); }) &&
+                         lane_free(x, LEFT_LANE, Vehicles::length(vehicle))) {
+                    vehicle_new_lane = LEFT_LANE;
+                }
+                if (vehicle_new_lane != l) {
+                    PROFILE_COUNT(LaneChanges);
+                }
+                m_next[vehicle_new_lane].set(x, vehicle);
+            }
+        }
+
+        // Sub-step 2: Move forward in the lanes, from the next lanes back into the road
+        PROFILE_PHASE(Move);
+        for (auto& lane : m_road) {
+            lane.reset();
+        }
+        for (int8_t l = 1; l >= 0; --l) {
+            advance<false>(m_next[l], l, m_road[l], stats, num_vehicles, num_occupied_spaces);
+        }
+    }
+    finish_update(stats, num_vehicles, num_occupied_spaces, m_left_lane_begin);
+}
+
+template <uint8_t LANES, UpdateRule RULE, class Vehicles, class Slowdown>
+template <bool SLOWDOWN>
+void RoadCells<LANES, RULE, Vehicles, Slowdown>::advance(const Lane& from, uint8_t lane, Lane& to, TrafficDataSample& stats,
+                                                          uint32_t& num_vehicles, uint32_t& num_occupied_spaces) {
+    // Position of the vehicle in front before the step, the same as from.next_occupied(x + 1)
+    int32_t leader = INT32_MAX;
+    for (int32_t x = from.prev_occupied(m_cell_count - 1); x >= 0; x = from.prev_occupied(x - 1)) {
+        PROFILE_PHASE(Move);
+        auto vehicle = from.get(x);
+
+        if constexpr (SLOWDOWN) {
+            // Step 1: Random acceleration / deceleration
+            PROFILE_PHASE(Slowdown);
+            slow_down(vehicle, lane, x);
+        }
+
+        // Step 2: Keep the distance to the leader before the step
+        PROFILE_PHASE(Gap);
+        int32_t distance = 0;
+        if (LANES == 1 || lane == RIGHT_LANE || static_cast<uint32_t>(x) >= m_left_lane_begin) {
+            PROFILE_COUNT(GapProbes);
+            distance = leader != INT32_MAX ? std::max(0, leader - x - Vehicles::length(from, leader)) : INT32_MAX;
+        }
+        if (vehicle.get_speed() > distance) {
+            vehicle.set_speed(distance);
+        }
+
+        // Step 3: Move the vehicle, if new position is still in scope
+        PROFILE_PHASE(Move);
+        uint32_t vehicle_new_pos = x + vehicle.get_speed();
+        if (vehicle_new_pos < m_cell_count) {
+            num_vehicles += 1;
+            num_occupied_spaces += Vehicles::length(vehicle);
             stats.avg_speed += vehicle.get_speed();
+            to.set(vehicle_new_pos, vehicle);
+        }
+        else {
+            stats.flux += 1;
         }
+        leader = x;
     }
-    stats.avg_speed = num_vehicles > 0 ? stats.avg_speed / num_vehicles : 0;
-    stats.density = num_occupied_spaces / static_cast<float>(m_road[RIGHT_LANE].size() + (m_road[LEFT_LANE].size() - m_left_lane_begin));
-    stats.road_snapshot = {Road::to_str(RIGHT_LANE), Road::to_str(LEFT_LANE, m_left_lane_begin)};
-    return stats;
 }
 
-int32_t RoadMapTwoLane::get_driving_distance(uint32_t from, uint8_t lane) {
-    if (lane == LEFT_LANE && from < m_left_lane_begin) {
+template <uint8_t LANES, UpdateRule RULE, class Vehicles, class Slowdown>
+int32_t RoadCells<LANES, RULE, Vehicles, Slowdown>::prev_occupied(int32_t from) const {
+    if constexpr (LANES == 1) {
+        return m_road[RIGHT_LANE].prev_occupied(from);
+    }
+    else {
+        return std::max(m_road[LEFT_LANE].prev_occupied(from), m_road[RIGHT_LANE].prev_occupied(from));
+    }
+}
+
+template <uint8_t LANES, UpdateRule RULE, class Vehicles, class Slowdown>
+int32_t RoadCells<LANES, RULE, Vehicles, Slowdown>::driving_distance(uint32_t from, uint8_t lane) const {
+    if (LANES > 1 && lane == LEFT_LANE && from < m_left_lane_begin) {
+        return 0; // In case the second lane has not started yet
+    }
+    PROFILE_COUNT(GapProbes);
+    int32_t leader = m_leader[lane];
+    if (leader == INT32_MAX) {
+        return INT32_MAX;
+    }
+    int32_t distance = leader - static_cast<int32_t>(from) - Vehicles::length(m_road[lane], leader);
+    return distance >= 0 ? distance : 0;
+}
+
+template <uint8_t LANES, UpdateRule RULE, class Vehicles, class Slowdown>
+int32_t RoadCells<LANES, RULE, Vehicles, Slowdown>::lane_gap(const Lane& lane, uint32_t from, uint8_t lane_index) const {
+    if (LANES > 1 && lane_index == LEFT_LANE && from < m_left_lane_begin) {
         return 0; // In case the second lane has not started yet
     }
+    PROFILE_COUNT(GapProbes);
+    int32_t leader = lane.next_occupied(from + 1);
+    if (leader == INT32_MAX) {
+        return INT32_MAX;
+    }
+    int32_t distance = leader - static_cast<int32_t>(from) - Vehicles::length(lane, leader);
+    return distance >= 0 ? distance : 0;
+}
+
+template <uint8_t LANES, UpdateRule RULE, class Vehicles, class Slowdown>
+template <typename Gap>
+bool RoadCells<LANES, RULE, Vehicles, Slowdown>::overtakes(const Vehicle& vehicle, uint32_t cell, Gap gap) const {
+    // If left lane started
+    // If faster than vehicle in front
+    // If overtake wanted
+    // If the distance in the left lane is bigger than the distance in right lane
+    return cell > m_left_lane_begin &&
+           vehicle.get_speed() > gap(cell, RIGHT_LANE) &&
+           PROFILE_COUNTED(LaneChangeAttempts) &&
+           draw_percent(m_overtake_gen, RIGHT_LANE, cell) < RAND_OVERTAKE_TH &&
+           gap(cell, LEFT_LANE) > gap(cell, RIGHT_LANE);
+}
+
+template <uint8_t LANES, UpdateRule RULE, class Vehicles, class Slowdown>
+bool RoadCells<LANES, RULE, Vehicles, Slowdown>::lane_free(uint32_t position, uint8_t lane, uint8_t vehicle_length) const {
+    if constexpr (Vehicles::CARS_ONLY) {
+        // Nothing reaches back over the cell
+        PROFILE_COUNT(GapProbes);
+        return position + 2 < m_cell_count && !m_road[lane].occupied(position);
+    }
+    else {
+        return lane_free_check(position, lane, vehicle_length);
+    }
+}
 
-    for (uint32_t i = from; i < m_cell_count; ++i) {
-        if (m_road[lane][i].has_value()) {
-            int32_t distance = i - from - m_road[lane][i].value().Length;
-            return distance >= 0 ? distance : 0;
+template <uint8_t LANES, UpdateRule RULE, class Vehicles, class Slowdown>
+bool RoadCells<LANES, RULE, Vehicles, Slowdown>::entry_free(uint8_t vehicle_length) {
+    if constexpr (Vehicles::CARS_ONLY) {
+        for (uint8_t i = 0; i < vehicle_length; ++i) {
+            if (!lane_free(i, RIGHT_LANE, 1)) {
+                return false;
+            }
         }
+        return true;
+    }
+    else {
+        return Road::entry_free(vehicle_length);
     }
-    return INT32_MAX;
 }
 
-std::string RoadMapTwoLane::to_str() const {
-    std::string road_string {};
-    road_string += Road::to_str(LEFT_LANE, m_left_lane_begin) + '\n';
-    road_string += Road::to_str(RIGHT_LANE);
-    return road_string;
+template <uint8_t LANES, UpdateRule RULE, class Vehicles, class Slowdown>
+void RoadCells<LANES, RULE, Vehicles, Slowdown>::place_at_entry(const Vehicle& vehicle) {
+    if (Vehicles::CARS_ONLY && vehicle.get_vehicle_type() != vt_t::car) {
+        throw std::invalid_argument("The road is specialised for cars only");
+    }
+    Road::place_at_entry(vehicle);
 }
 
+template <uint8_t LANES, UpdateRule RULE, class Vehicles, class Slowdown>
+void RoadCells<LANES, RULE, Vehicles, Slowdown>::to_str(std::string& road_string) const {
+    road_string.clear();
+    if constexpr (LANES > 1) {
+        lane_to_str(LEFT_LANE, m_left_lane_begin, road_string);
+        road_string += '\n';
+    }
+    lane_to_str(RIGHT_LANE, 0, road_string);
+}
+
+template <uint8_t LANES, UpdateRule RULE, class Vehicles, class Slowdown>
+void RoadCells<LANES, RULE, Vehicles, Slowdown>::record(uint8_t lane, uint32_t space_stride, uint8_t* row) const {
+    Road::record(lane, lane == LEFT_LANE ? m_left_lane_begin : 0, space_stride, row);
+}
 
-uint32_t RoadMapTwoLane::size() const {
+template <uint8_t LANES, UpdateRule RULE, class Vehicles, class Slowdown>
+uint32_t RoadCells<LANES, RULE, Vehicles, Slowdown>::size() const {
     return m_cell_count;
 }
+
+/**
+ * The configurations of the dispatch table, every one is compiled separately,
+ * so a new entry does not change the code of the others
+ */
+template <uint8_t LANES, UpdateRule RULE, class Vehicles>
+using CellsEngine = RoadCells<LANES, RULE, Vehicles, std::conditional_t<LANES == 1, RandomSlowdown, RightLaneSlowdown>>;
+
+template class RoadCells<1, UpdateRule::Sequential, MixedVehicles, RandomSlowdown>;
+template class RoadCells<1, UpdateRule::Sequential, CarsOnly, RandomSlowdown>;
+template class RoadCells<1, UpdateRule::Synchronous, MixedVehicles, RandomSlowdown>;
+template class RoadCells<1, UpdateRule::Synchronous, CarsOnly, RandomSlowdown>;
+template class RoadCells<2, UpdateRule::Sequential, MixedVehicles, RightLaneSlowdown>;
+template class RoadCells<2, UpdateRule::Sequential, CarsOnly, RightLaneSlowdown>;
+template class RoadCells<2, UpdateRule::Synchronous, MixedVehicles, RightLaneSlowdown>;
+template class RoadCells<2, UpdateRule::Synchronous, CarsOnly, RightLaneSlowdown>;
+
+namespace {
+
+using CellsFactory = std::unique_ptr<Road> (*)(uint32_t road_len, uint32_t max_speed, uint8_t two_lane_portion, StreamKey key);
+
+template <class Engine>
+std::unique_ptr<Road> make_engine(uint32_t road_len, uint32_t max_speed, uint8_t two_lane_portion, StreamKey key) {
+    return std::make_unique<Engine>(road_len, max_speed, two_lane_portion, key);
+}
+
+struct CellsEntry {
+    CellsConfig config;
+    CellsFactory make;
+};
+
+const CellsEntry CELLS_ENGINES[] = {
+    {{1, UpdateRule::Sequential, false}, make_engine<CellsEngine<1, UpdateRule::Sequential, MixedVehicles>>},
+    {{1, UpdateRule::Sequential, true}, make_engine<CellsEngine<1, UpdateRule::Sequential, CarsOnly>>},
+    {{1, UpdateRule::Synchronous, false}, make_engine<CellsEngine<1, UpdateRule::Synchronous, MixedVehicles>>},
+    {{1, UpdateRule::Synchronous, true}, make_engine<CellsEngine<1, UpdateRule::Synchronous, CarsOnly>>},
+    {{2, UpdateRule::Sequential, false}, make_engine<CellsEngine<2, UpdateRule::Sequential, MixedVehicles>>},
+    {{2, UpdateRule::Sequential, true}, make_engine<CellsEngine<2, UpdateRule::Sequential, CarsOnly>>},
+    {{2, UpdateRule::Synchronous, false}, make_engine<CellsEngine<2, UpdateRule::Synchronous, MixedVehicles>>},
+    {{2, UpdateRule::Synchronous, true}, make_engine<CellsEngine<2, UpdateRule::Synchronous, CarsOnly>>},
+};
+
+}
+
+std::unique_ptr<Road> make_cells_road(const CellsConfig& config, uint32_t road_len, uint32_t max_speed, uint8_t two_lane_portion, StreamKey key) {
+    for (const auto& engine : CELLS_ENGINES) {
+        if (engine.config == config) {
+            return engine.make(road_len, max_speed, two_lane_portion, key);
+        }
+    }
+    throw std::invalid_argument("The cells engine has no specialisation for the configuration");
+}
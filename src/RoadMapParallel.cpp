@@ -0,0 +1,165 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 27-12-2023
+ * @file RoadMapParallel.cpp
+ */
+
+#include "include/RoadMapParallel.h"
+
+#include <algorithm>
+#include <utility>
+
+RoadMapParallel::RoadMapParallel(uint32_t road_len, uint32_t max_speed, StreamKey key, uint32_t threads)
+        : Road(road_len, max_speed, key), m_pool(threads) {
+    m_road.emplace_back(m_cell_count);
+    m_next.assign(1, Lane(m_cell_count));
+    split();
+}
+
+void RoadMapParallel::reset(uint32_t max_speed, uint8_t two_lane_portion, StreamKey key) {
+    Road::reset(max_speed, two_lane_portion, key);
+    split();
+}
+
+void RoadMapParallel::to_str(std::string& road_string) const {
+    road_string.clear();
+    lane_to_str(RIGHT_LANE, 0, road_string);
+}
+
+uint32_t RoadMapParallel::size() const {
+    return m_cell_count;
+}
+
+void RoadMapParallel::split() {
+    uint32_t target = (m_cell_count + m_pool.size() * CHUNKS_PER_THREAD - 1) / (m_pool.size() * CHUNKS_PER_THREAD);
+    uint32_t chunk_cells = std::max({target, MIN_CHUNK_CELLS, m_max_speed + 1});
+    chunk_cells = (chunk_cells + Lane::WORD_BITS - 1) / Lane::WORD_BITS * Lane::WORD_BITS;
+
+    // The remainder goes to the last chunk, so a vehicle never skips a whole chunk
+    uint32_t count = std::max(1u, m_cell_count / chunk_cells);
+    m_chunks.resize(count);
+    for (uint32_t c = 0; c < count; ++c) {
+        m_chunks[c].begin = c * chunk_cells;
+        m_chunks[c].end = c + 1 < count ? (c + 1) * chunk_cells : m_cell_count;
+    }
+}
+
+void RoadMapParallel::update(TrafficDataSample& stats) {
+    stats.avg_speed = 0;
+    stats.flux = 0;
+
+    PROFILE_PHASE(Move);
+    for (auto& chunk : m_chunks) {
+        m_pool.submit([this, &chunk] { sweep(chunk); });
+    }
+    m_pool.wait();
+    resolve_boundaries();
+    for (uint32_t c = 0; c < m_chunks.size(); ++c) {
+        m_pool.submit([this, c] { write(c); });
+    }
+    m_pool.wait();
+    std::swap(m_road[RIGHT_LANE], m_next[RIGHT_LANE]);
+
+    // Sums of whole speeds, the order of the additions does not change the result
+    uint32_t num_vehicles = 0;
+    uint32_t num_occupied_spaces = 0;
+    for (const auto& chunk : m_chunks) {
+        num_vehicles += chunk.num_vehicles;
+        num_occupied_spaces += chunk.num_occupied_spaces;
+        stats.avg_speed += chunk.speed_sum;
+        stats.flux += chunk.flux;
+    }
+    finish_update(stats, num_vehicles, num_occupied_spaces);
+}
+
+void RoadMapParallel::sweep(Chunk& chunk) {
+    const auto& lane = m_road[RIGHT_LANE];
+    chunk.vehicles.clear();
+    chunk.position.clear();
+    for (int32_t i = lane.prev_occupied(chunk.end - 1); i >= static_cast<int32_t>(chunk.begin); i = lane.prev_occupied(i - 1)) {
+        auto vehicle = lane.get(i);
+        RandomSlowdown::apply(vehicle, RIGHT_LANE, m_max_speed, m_min_speed, [&] { return draw_percent(m_slowdown_gen, RIGHT_LANE, i); });
+        chunk.vehicles.push_back(vehicle);
+        chunk.position.push_back(i);
+    }
+    chunk.new_position.resize(chunk.vehicles.size());
+
+    int32_t leader = lane.next_occupied(chunk.end);
+    uint8_t leader_length = leader != INT32_MAX ? lane.length(leader) : 0;
+    if (m_update_rule == UpdateRule::Synchronous) {
+        // Gaps to the leaders before the step, nothing depends on the moves in the next chunk
+        chunk.coupled = 0;
+        for (uint32_t k = 0; k < chunk.vehicles.size(); ++k) {
+            chunk.new_position[k] = drive(chunk.vehicles[k], chunk.position[k], leader, leader_length);
+            leader = chunk.position[k];
+            leader_length = chunk.vehicles[k].length();
+        }
+        return;
+    }
+
+    // The leader moves only forward, so a vehicle whose speed fits into the gap
+    // to the old position of its leader is not limited by the leader's new position
+    chunk.coupled = chunk.vehicles.size();
+    for (uint32_t k = 0; k < chunk.vehicles.size(); ++k) {
+        auto& vehicle = chunk.vehicles[k];
+        if (leader == INT32_MAX || vehicle.get_speed() <= leader - static_cast<int32_t>(chunk.position[k]) - leader_length) {
+            chunk.coupled = k;
+            chunk.new_position[k] = chunk.position[k] + vehicle.get_speed();
+            break;
+        }
+        leader = chunk.position[k];
+        leader_length = vehicle.length();
+    }
+    for (uint32_t k = chunk.coupled + 1; k < chunk.vehicles.size(); ++k) {
+        int32_t new_leader = chunk.new_position[k - 1] < m_cell_count ? chunk.new_position[k - 1] : INT32_MAX;
+        chunk.new_position[k] = drive(chunk.vehicles[k], chunk.position[k], new_leader, chunk.vehicles[k - 1].length());
+    }
+}
+
+void RoadMapParallel::resolve_boundaries() {
+    int32_t leader = INT32_MAX;
+    uint8_t leader_length = 0;
+    for (auto chunk = m_chunks.rbegin(); chunk != m_chunks.rend(); ++chunk) {
+        for (uint32_t k = 0; k < chunk->coupled; ++k) {
+            chunk->new_position[k] = drive(chunk->vehicles[k], chunk->position[k], leader, leader_length);
+            leader = chunk->new_position[k] < m_cell_count ? chunk->new_position[k] : INT32_MAX;
+            leader_length = chunk->vehicles[k].length();
+        }
+        if (!chunk->vehicles.empty()) {
+            leader = chunk->new_position.back() < m_cell_count ? chunk->new_position.back() : INT32_MAX;
+            leader_length = chunk->vehicles.back().length();
+        }
+    }
+}
+
+void RoadMapParallel::write(uint32_t chunk_index) {
+    auto& chunk = m_chunks[chunk_index];
+    auto& next = m_next[RIGHT_LANE];
+    next.reset(chunk.begin, chunk.end);
+
+    // Vehicles of the previous chunk which crossed into this one, they are at the front of its list
+    if (chunk_index > 0) {
+        const auto& previous = m_chunks[chunk_index - 1];
+        for (uint32_t k = 0; k < previous.vehicles.size() && previous.new_position[k] >= chunk.begin; ++k) {
+            next.set(previous.new_position[k], previous.vehicles[k]);
+        }
+    }
+
+    chunk.num_vehicles = 0;
+    chunk.num_occupied_spaces = 0;
+    chunk.flux = 0;
+    chunk.speed_sum = 0;
+    for (uint32_t k = 0; k < chunk.vehicles.size(); ++k) {
+        const auto& vehicle = chunk.vehicles[k];
+        if (chunk.new_position[k] >= m_cell_count) {
+            chunk.flux += 1;
+            continue;
+        }
+        chunk.num_vehicles += 1;
+        chunk.num_occupied_spaces += vehicle.length();
+        chunk.speed_sum += vehicle.get_speed();
+        if (chunk.new_position[k] < chunk.end) {
+            next.set(chunk.new_position[k], vehicle);
+        }
+    }
+}
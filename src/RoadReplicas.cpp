@@ -0,0 +1,317 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 29-12-2023
+ * @file RoadReplicas.cpp
+ */
+
+#include "include/RoadReplicas.h"
+#include "include/SimdLevel.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+/**
+ * Leader of a vehicle with nothing in front of it, far enough to never limit its speed
+ */
+const int32_t FAR_AWAY = 1 << 30;
+
+/**
+ * Bits of the roads with a vehicle in the cell, from V classes of the row
+ */
+template <int V>
+uint32_t row_mask(const uint8_t* classes) {
+    uint32_t mask = 0;
+    for (int word = 0; word < (V + 7) / 8; ++word) {
+        uint64_t bytes = 0;
+        std::memcpy(&bytes, classes + word * 8, std::min(V, 8));
+        // The classes fit 4 bits, fold them into the lowest bit of every byte and gather the bits
+        bytes |= bytes >> 2;
+        bytes = (bytes | bytes >> 1) & 0x0101010101010101ull;
+        mask |= static_cast<uint32_t>((bytes * 0x0102040810204080ull) >> 56) << (word * 8);
+    }
+    return mask;
+}
+
+using Table = RoadReplicas::Table;
+
+/**
+ * First V bytes of the table as 32 bit lanes, returned through the reference to keep the vector ABI of the caller
+ */
+template <int V>
+void widen(Table bytes, typename SimdLanes<V>::i32& lanes) {
+    typename SimdLanes<V>::u8 narrow;
+    std::memcpy(&narrow, &bytes, sizeof(narrow));
+    lanes = __builtin_convertvector(narrow, typename SimdLanes<V>::i32);
+}
+
+/**
+ * Sweep the roads from their end, V roads per iteration with GCC vector types
+ * Instantiated below for every SIMD level, under the instruction set of the level
+ */
+template <int V>
+void sweep_kernel(RoadReplicas::Sweep& sweep) {
+    using u8 = typename SimdLanes<V>::u8;
+    using i32 = typename SimdLanes<V>::i32;
+    using u32 = typename SimdLanes<V>::u32;
+    using u64 = typename SimdLanes<V>::u64;
+    using u16 = typename SimdLanes<V>::u16;
+    const uint32_t width = RoadReplicas::WIDTH;
+
+    for (uint32_t base = 0; base < sweep.roads; base += V) {
+        u32 replicas;
+        std::memcpy(&replicas, sweep.replica + base, sizeof(replicas));
+        // Position and length of the leader of every road, before or after the step by the update rule
+        i32 leader = i32 {} + FAR_AWAY;
+        i32 leader_length {};
+        i32 num_vehicles {};
+        i32 num_occupied_spaces {};
+        i32 speed_sum {};
+        i32 flux {};
+
+        for (int32_t cell = static_cast<int32_t>(sweep.cells) - 1; cell >= 0; --cell) {
+            uint8_t* row_class = sweep.vehicle_class + static_cast<size_t>(cell) * width + base;
+            speed_t* row_speed = sweep.speed + static_cast<size_t>(cell) * width + base;
+            uint32_t mask = row_mask<V>(row_class);
+            if (!mask) {
+                continue;
+            }
+            // Parameters of the classes, the codes fit 4 bits and index the 16 entry tables by a byte shuffle
+            Table codes {};
+            std::memcpy(&codes, row_class, V);
+            i32 length;
+            i32 acceleration;
+            i32 deceleration;
+            widen<V>(__builtin_shuffle(sweep.length, codes), length);
+            widen<V>(__builtin_shuffle(sweep.acceleration, codes), acceleration);
+            widen<V>(__builtin_shuffle(sweep.deceleration, codes), deceleration);
+            u8 classes;
+            std::memcpy(&classes, row_class, sizeof(classes));
+            i32 present = length != 0;
+            u16 packed_speed;
+            std::memcpy(&packed_speed, row_speed, sizeof(packed_speed));
+            i32 speed = __builtin_convertvector(packed_speed, i32);
+
+            // Step 1: Random acceleration / deceleration, x % 100 as a multiplication by the reciprocal
+            // A vector of draws costs as much as a few single ones, so rows with few vehicles draw them one by one
+            uint32_t index = static_cast<uint32_t>(cell * 2 + RIGHT_LANE);
+            u32 random = u32 {} + index;
+            if (__builtin_popcount(mask) > V / 4) {
+                sweep.slowdown_gen[0].draw<u32, u64>(sweep.step, random, replicas);
+            }
+            else {
+                for (uint32_t bits = mask; bits; bits &= bits - 1) {
+                    int i = __builtin_ctz(bits);
+                    random[i] = sweep.slowdown_gen[base + i].draw(sweep.step, index);
+                }
+            }
+            u32 quotient = __builtin_convertvector((__builtin_convertvector(random, u64) * 0x51EB851Full) >> 37, u32);
+            i32 percent = reinterpret_cast<i32&>(random) - reinterpret_cast<i32&>(quotient) * 100;
+            i32 whole = speed >> Vehicle::SPEED_FRACTION_BITS;
+            i32 accelerated = whole < sweep.max_speed ? speed + acceleration : speed;
+            i32 decelerated = (whole >= sweep.min_speed) & (speed > deceleration) ? speed - deceleration : speed;
+            speed = percent > Road::RAND_DEC_TH ? accelerated : decelerated;
+            whole = speed >> Vehicle::SPEED_FRACTION_BITS;
+
+            // Step 2: Check driving distance, Vehicle::set_speed keeps the fraction and takes the speed as a byte
+            i32 distance = leader - cell - leader_length;
+            i32 limited = (speed & Vehicle::SPEED_FRACTION_MASK) | ((distance & 0xFF) << Vehicle::SPEED_FRACTION_BITS);
+            speed = whole > distance ? limited : speed;
+            whole = speed >> Vehicle::SPEED_FRACTION_BITS;
+            i32 new_position = cell + whole;
+
+            // Step 3: Move the vehicles which stay on the road
+            i32 on_road = present & (new_position < static_cast<int32_t>(sweep.cells));
+            num_vehicles -= on_road;
+            num_occupied_spaces += on_road & length;
+            speed_sum += on_road & whole;
+            flux -= present & ~on_road;
+            // All vehicles of the row are taken off the road, the ones which stay are placed again
+            std::memset(row_class, 0, V);
+            for (uint32_t bits = mask; bits; bits &= bits - 1) {
+                int i = __builtin_ctz(bits);
+                if (new_position[i] < static_cast<int32_t>(sweep.cells)) {
+                    size_t target = static_cast<size_t>(new_position[i]) * width + base + i;
+                    sweep.vehicle_class[target] = classes[i];
+                    sweep.speed[target] = static_cast<speed_t>(speed[i]);
+                }
+            }
+            if (sweep.synchronous) {
+                leader = present ? cell : leader;
+                leader_length = present ? length : leader_length;
+            }
+            else {
+                leader = on_road ? new_position : leader;
+                leader_length = on_road ? length : leader_length;
+            }
+        }
+
+        for (uint32_t i = 0; i < V && base + i < sweep.roads; ++i) {
+            sweep.num_vehicles[base + i] = num_vehicles[i];
+            sweep.num_occupied_spaces[base + i] = num_occupied_spaces[i];
+            sweep.speed_sum[base + i] = speed_sum[i];
+            sweep.flux[base + i] = flux[i];
+        }
+    }
+}
+
+}
+
+template void sweep_kernel<4>(RoadReplicas::Sweep& sweep);
+
+#if defined(__x86_64__) || defined(__i386__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+template void Philox::draw<SimdLanes<8>::u32, SimdLanes<8>::u64>(uint32_t step, SimdLanes<8>::u32& numbers, const SimdLanes<8>::u32& replicas) const;
+template void sweep_kernel<8>(RoadReplicas::Sweep& sweep);
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+template void Philox::draw<SimdLanes<16>::u32, SimdLanes<16>::u64>(uint32_t step, SimdLanes<16>::u32& numbers, const SimdLanes<16>::u32& replicas) const;
+template void sweep_kernel<16>(RoadReplicas::Sweep& sweep);
+#pragma GCC pop_options
+#endif
+
+RoadReplicas::RoadReplicas(uint32_t road_len, uint32_t max_speed, uint64_t seed, uint32_t first_replica, uint32_t replicas)
+                           : RoadBatch(road_len, max_speed, replicas) {
+    if (replicas == 0 || replicas > WIDTH) {
+        throw std::invalid_argument("A replicas road holds 1 to " + std::to_string(WIDTH) + " replications");
+    }
+    for (uint32_t road = 0; road < WIDTH; ++road) {
+        m_replica[road] = first_replica + road;
+    }
+    for (uint32_t road = 0; road < m_replicas; ++road) {
+        m_slowdown_gens.emplace_back(StreamKey {seed, m_replica[road]}, RandomStream::Slowdown);
+    }
+    m_class.assign(static_cast<size_t>(m_cell_count) * WIDTH, 0);
+    m_speed.assign(static_cast<size_t>(m_cell_count) * WIDTH, 0);
+    m_queues.assign(m_replicas, RingBuffer<Vehicle>(Road::QUEUE_CAPACITY, Vehicle(vt_t::car)));
+}
+
+void RoadReplicas::update(std::vector<TrafficDataSample>& stats) {
+    PROFILE_PHASE(Move);
+    Sweep sweep {m_class.data(), m_speed.data(), m_cell_count, m_replicas,
+                 static_cast<int32_t>(m_max_speed), static_cast<int32_t>(m_min_speed), {}, {}, {},
+                 m_update_rule == UpdateRule::Synchronous, m_slowdown_gens.data(), m_step, m_replica.data(), {}, {}, {}, {}};
+    const auto& classes = VehicleClasses::table();
+    for (uint8_t type = 0; type < classes.size(); ++type) {
+        sweep.length[type + 1] = classes.length[type];
+        sweep.acceleration[type + 1] = static_cast<uint8_t>(classes.acceleration[type]);
+        sweep.deceleration[type + 1] = static_cast<uint8_t>(classes.deceleration[type]);
+    }
+    switch (simd_level()) {
+#if defined(__x86_64__) || defined(__i386__)
+        case SimdLevel::Avx512:
+            sweep_kernel<16>(sweep);
+            break;
+        case SimdLevel::Avx2:
+            sweep_kernel<8>(sweep);
+            break;
+#endif
+        default:
+            sweep_kernel<4>(sweep);
+    }
+
+    stats.resize(m_replicas);
+    for (uint32_t road = 0; road < m_replicas; ++road) {
+        auto& sample = stats[road];
+        uint32_t num_vehicles = sweep.num_vehicles[road];
+        uint32_t num_occupied_spaces = sweep.num_occupied_spaces[road];
+        sample.avg_speed = sweep.speed_sum[road];
+        sample.flux = sweep.flux[road];
+
+        PROFILE_PHASE(Queue);
+        auto new_vehicle_pos = insert_vehicle_from_queue(road);
+        PROFILE_PHASE(Stats);
+        if (new_vehicle_pos >= 0 && m_class[index(new_vehicle_pos, road)] != 0) {
+            num_vehicles++;
+            num_occupied_spaces += length(new_vehicle_pos, road);
+            sample.avg_speed += m_speed[index(new_vehicle_pos, road)] >> Vehicle::SPEED_FRACTION_BITS;
+        }
+        sample.avg_speed = num_vehicles > 0 ? sample.avg_speed / num_vehicles : 0;
+        sample.density = num_occupied_spaces / static_cast<float>(m_cell_count);
+        if (m_snapshots) {
+            PROFILE_PHASE(Snapshot);
+            sample.road_snapshot.resize(1);
+            to_str(road, sample.road_snapshot[RIGHT_LANE]);
+        }
+        else {
+            sample.road_snapshot.clear();
+        }
+    }
+    PROFILE_PHASE(Other);
+    m_step++;
+}
+
+void RoadReplicas::insert(uint32_t road, Vehicle vehicle) {
+    if (vehicle.get_speed() < m_min_speed) {
+        vehicle.set_speed(m_min_speed);
+    }
+    else if (vehicle.get_speed() > m_max_speed) {
+        vehicle.set_speed(m_max_speed);
+    }
+    if (!entry_free(road, entry_length(vehicle))) {
+        PROFILE_COUNT(QueueRejections);
+        m_queues[road].push(vehicle);
+        return;
+    }
+    PROFILE_COUNT(QueueInserts);
+    place_at_entry(road, vehicle);
+}
+
+int32_t RoadReplicas::insert_vehicle_from_queue(uint32_t road) {
+    auto& queue = m_queues[road];
+    if (queue.empty()) {
+        return 0;
+    }
+    auto vehicle = queue.front();
+    if (!entry_free(road, entry_length(vehicle))) {
+        PROFILE_COUNT(QueueRejections);
+        return -1;
+    }
+    PROFILE_COUNT(QueueInserts);
+    place_at_entry(road, vehicle);
+    queue.pop();
+    return vehicle.length() - 1;
+}
+
+bool RoadReplicas::entry_free(uint32_t road, uint8_t vehicle_length) const {
+    for (uint32_t position = 0; position < vehicle_length; ++position) {
+        if (position + 2 >= m_cell_count) {
+            return false;
+        }
+        if (length(position + 1, road) > 1 || length(position + 2, road) > 2) {
+            return false;
+        }
+        uint32_t rear = position >= vehicle_length ? position - vehicle_length + 1 : 0;
+        for (uint32_t cell = rear; cell <= position; ++cell) {
+            if (m_class[index(cell, road)] != 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void RoadReplicas::place_at_entry(uint32_t road, const Vehicle& vehicle) {
+    m_class[index(vehicle.length() - 1, road)] = static_cast<uint8_t>(vehicle.get_vehicle_type()) + 1;
+    m_speed[index(vehicle.length() - 1, road)] = vehicle.get_raw_speed();
+}
+
+void RoadReplicas::to_str(uint32_t road, std::string& road_string) const {
+    road_string.clear();
+    for (int32_t i = m_cell_count - 1; i >= 0; --i) {
+        uint8_t vehicle_class = m_class[index(i, road)];
+        if (vehicle_class == 0) {
+            road_string += '.';
+            continue;
+        }
+        auto vehicle = Vehicle::restore(static_cast<vt_t>(vehicle_class - 1), m_speed[index(i, road)]);
+        vehicle.append_str(road_string);
+        i -= vehicle.length() - 1;
+    }
+    std::reverse(road_string.begin(), road_string.end());
+}
@@ -0,0 +1,243 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 28-12-2023
+ * @file RoadSimd.cpp
+ */
+
+#include "include/RoadSimd.h"
+#include "include/SimdLevel.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+/**
+ * Target of a car which leaves the road, larger than any cell and small enough to add indices to it
+ */
+const int32_t FAR_AWAY = 1 << 30;
+
+/**
+ * State carried from one block of cars to the next one
+ */
+struct Carry {
+    /**
+     * Position of the car in front before the step, the leader of the synchronous rule
+     */
+    int32_t old_leader;
+    /**
+     * New position of the car in front plus its index, the running minimum of the sequential rule
+     */
+    int32_t bound;
+};
+
+/**
+ * Update W cars per iteration with GCC vector types
+ * Instantiated below for every SIMD level, under the instruction set of the level
+ */
+template <int W>
+void sweep_kernel(RoadSimd::Sweep& sweep) {
+    using i32 = typename SimdLanes<W>::i32;
+    using u32 = typename SimdLanes<W>::u32;
+    using u64 = typename SimdLanes<W>::u64;
+    using u16 = typename SimdLanes<W>::u16;
+
+    i32 lane {};
+    for (int i = 0; i < W; ++i) {
+        lane[i] = i;
+    }
+    const i32 cells = i32 {} + static_cast<int32_t>(sweep.cells);
+
+    Carry carry {FAR_AWAY + 1, INT32_MAX};
+    for (uint32_t k = 0; k < sweep.count; k += W) {
+        uint32_t active = std::min<uint32_t>(W, sweep.count - k);
+        i32 position = i32 {} + FAR_AWAY;
+        u16 packed_speed {};
+        std::memcpy(&position, sweep.position + k, active * sizeof(int32_t));
+        std::memcpy(&packed_speed, sweep.speed + k, active * sizeof(speed_t));
+        i32 speed = __builtin_convertvector(packed_speed, i32);
+        i32 valid = lane < static_cast<int32_t>(active);
+
+        // Step 1: Random acceleration / deceleration, x % 100 as a multiplication by the reciprocal
+        u32 random = reinterpret_cast<u32&>(position) * 2 + RIGHT_LANE;
+        sweep.slowdown_gen->draw<u32, u64>(sweep.step, random);
+        u32 quotient = __builtin_convertvector((__builtin_convertvector(random, u64) * 0x51EB851Full) >> 37, u32);
+        i32 percent = reinterpret_cast<i32&>(random) - reinterpret_cast<i32&>(quotient) * 100;
+        // The same fixed point arithmetic as Vehicle
+        i32 whole = speed >> Vehicle::SPEED_FRACTION_BITS;
+        i32 accelerated = whole < sweep.max_speed ? speed + sweep.acceleration : speed;
+        i32 decelerated = (whole >= sweep.min_speed) & (speed > sweep.deceleration) ? speed - sweep.deceleration : speed;
+        speed = percent > Road::RAND_DEC_TH ? accelerated : decelerated;
+        whole = speed >> Vehicle::SPEED_FRACTION_BITS;
+
+        // Step 2: Limit by the leader, masked minimum of the target and the limit
+        i32 target = position + whole;
+        target = target < cells ? target : FAR_AWAY;
+        i32 new_position;
+        if (sweep.synchronous) {
+            // Leader is the previous car before the step
+            i32 shift = lane > 0 ? lane - 1 : lane + W;
+            i32 old_leader = __builtin_shuffle(position, i32 {} + carry.old_leader, shift);
+            i32 limit = old_leader - 1;
+            new_position = target < limit ? target : limit;
+        }
+        else {
+            // new_k = min(target_k, new_(k-1) - 1), so new_k + k is the prefix minimum of target_k + k
+            i32 bound = target + (lane + static_cast<int32_t>(k));
+            for (int distance = 1; distance < W; distance *= 2) {
+                i32 shift = lane >= distance ? lane - distance : lane + W;
+                i32 shifted = __builtin_shuffle(bound, i32 {} + INT32_MAX, shift);
+                bound = shifted < bound ? shifted : bound;
+            }
+            bound = carry.bound < bound ? carry.bound : bound;
+            new_position = bound - (lane + static_cast<int32_t>(k));
+        }
+        i32 on_road = valid & (new_position < cells);
+        i32 limited = on_road & (new_position - position < whole);
+        // Vehicle::set_speed, the fraction is kept
+        speed = limited ? (speed & Vehicle::SPEED_FRACTION_MASK) | ((new_position - position) << Vehicle::SPEED_FRACTION_BITS) : speed;
+
+        // Step 3: Move
+        i32 moved = on_road ? new_position - position : 0;
+        for (int i = 0; i < W; ++i) {
+            sweep.speed_sum += moved[i];
+            sweep.left += (valid[i] & ~on_road[i]) & 1;
+        }
+        position = on_road ? new_position : position;
+        std::memcpy(sweep.position + k, &position, active * sizeof(int32_t));
+        packed_speed = __builtin_convertvector(speed, u16);
+        std::memcpy(sweep.speed + k, &packed_speed, active * sizeof(speed_t));
+        carry.old_leader = sweep.position[k + active - 1] - moved[active - 1];
+        carry.bound = new_position[active - 1] + k + active - 1;
+    }
+}
+
+}
+
+template void sweep_kernel<4>(RoadSimd::Sweep& sweep);
+
+#if defined(__x86_64__) || defined(__i386__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+template void Philox::draw<SimdLanes<8>::u32, SimdLanes<8>::u64>(uint32_t step, SimdLanes<8>::u32& numbers) const;
+template void sweep_kernel<8>(RoadSimd::Sweep& sweep);
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+template void Philox::draw<SimdLanes<16>::u32, SimdLanes<16>::u64>(uint32_t step, SimdLanes<16>::u32& numbers) const;
+template void sweep_kernel<16>(RoadSimd::Sweep& sweep);
+#pragma GCC pop_options
+#endif
+
+RoadSimd::RoadSimd(uint32_t road_len, uint32_t max_speed, StreamKey key) : Road(road_len, max_speed, key), m_first(0) {
+    Vehicle car(vt_t::car);
+    m_acceleration = car.acceleration();
+    m_deceleration = car.deceleration();
+}
+
+void RoadSimd::update(TrafficDataSample& stats) {
+    PROFILE_PHASE(Move);
+    Sweep sweep {m_position.data() + m_first, m_speed.data() + m_first, static_cast<uint32_t>(m_position.size() - m_first),
+                 m_cell_count, static_cast<int32_t>(m_max_speed), static_cast<int32_t>(m_min_speed), m_acceleration, m_deceleration,
+                 m_update_rule == UpdateRule::Synchronous, &m_slowdown_gen, m_step, 0, 0};
+    switch (simd_level()) {
+#if defined(__x86_64__) || defined(__i386__)
+        case SimdLevel::Avx512:
+            sweep_kernel<16>(sweep);
+            break;
+        case SimdLevel::Avx2:
+            sweep_kernel<8>(sweep);
+            break;
+#endif
+        default:
+            sweep_kernel<4>(sweep);
+    }
+
+    // The cars which left the road were in front of all others
+    m_first += sweep.left;
+    stats.flux = sweep.left;
+    stats.avg_speed = sweep.speed_sum;
+    uint32_t num_vehicles = m_position.size() - m_first;
+    compact();
+
+    PROFILE_PHASE(Queue);
+    auto new_vehicle_pos = insert_vehicle_from_queue();
+    PROFILE_PHASE(Stats);
+    if (new_vehicle_pos >= 0 && m_position.size() > m_first && m_position.back() == new_vehicle_pos) {
+        num_vehicles++;
+        stats.avg_speed += m_speed.back() >> Vehicle::SPEED_FRACTION_BITS;
+    }
+    stats.avg_speed = num_vehicles > 0 ? stats.avg_speed / num_vehicles : 0;
+    stats.density = num_vehicles / static_cast<float>(m_cell_count);
+    if (m_snapshots) {
+        PROFILE_PHASE(Snapshot);
+        stats.road_snapshot.resize(1);
+        to_str(stats.road_snapshot[RIGHT_LANE]);
+    }
+    else {
+        stats.road_snapshot.clear();
+    }
+    PROFILE_PHASE(Other);
+    m_step++;
+}
+
+void RoadSimd::reset(uint32_t max_speed, uint8_t two_lane_portion, StreamKey key) {
+    Road::reset(max_speed, two_lane_portion, key);
+    m_first = 0;
+    m_position.clear();
+    m_speed.clear();
+}
+
+bool RoadSimd::entry_free(uint8_t vehicle_length) {
+    // Same conditions as RoadVehicleList::entry_free, with cars only the rear most car decides
+    if (static_cast<uint32_t>(vehicle_length) + 1 >= m_cell_count) {
+        return false;
+    }
+    return m_position.size() == m_first || m_position.back() >= vehicle_length;
+}
+
+void RoadSimd::place_at_entry(const Vehicle& vehicle) {
+    if (vehicle.get_vehicle_type() != vt_t::car) {
+        throw std::invalid_argument("The SIMD engine supports only cars");
+    }
+    m_position.push_back(vehicle.length() - 1);
+    m_speed.push_back(vehicle.get_raw_speed());
+}
+
+void RoadSimd::compact() {
+    if (m_first == 0 || m_first * 2 < m_position.size()) {
+        return;
+    }
+    m_position.erase(m_position.begin(), m_position.begin() + m_first);
+    m_speed.erase(m_speed.begin(), m_speed.begin() + m_first);
+    m_first = 0;
+}
+
+void RoadSimd::to_str(std::string& road_string) const {
+    road_string.clear();
+    int32_t i = m_cell_count - 1;
+    for (uint32_t k = m_first; k < m_position.size(); ++k) {
+        road_string.append(i - m_position[k], '.');
+        Vehicle::restore(vt_t::car, m_speed[k]).append_str(road_string);
+        i = m_position[k] - 1;
+    }
+    if (i >= 0) {
+        road_string.append(i + 1, '.');
+    }
+    std::reverse(road_string.begin(), road_string.end());
+}
+
+void RoadSimd::record(uint8_t, uint32_t space_stride, uint8_t* row) const {
+    std::fill(row, row + (m_cell_count + space_stride - 1) / space_stride, CELL_EMPTY);
+    for (uint32_t k = m_first; k < m_position.size(); ++k) {
+        if (m_position[k] % space_stride == 0) {
+            row[m_position[k] / space_stride] = cell_code(vt_t::car, m_speed[k] >> Vehicle::SPEED_FRACTION_BITS);
+        }
+    }
+}
+
+uint32_t RoadSimd::size() const {
+    return m_cell_count;
+}
@@ -0,0 +1,174 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 14-12-2023
+ * @file RoadVehicleList.cpp
+ */
+
+#include "include/RoadVehicleList.h"
+
+#include <algorithm>
+
+RoadVehicleList::RoadVehicleList(uint32_t road_len, uint32_t max_speed, StreamKey key) : Road(road_len, max_speed, key), m_first(0) {
+}
+
+void RoadVehicleList::update(TrafficDataSample& stats) {
+    stats.avg_speed = 0;
+    stats.flux = 0;
+    uint32_t num_vehicles = 0;
+    uint32_t num_occupied_spaces = 0;
+
+    int32_t leader = INT32_MAX;
+    uint8_t leader_length = 0;
+
+    for (uint32_t k = m_first; k < m_vehicles.size(); ++k) {
+        auto& vehicle = m_vehicles[k];
+
+        // Step 1: Random acceleration / deceleration
+        PROFILE_PHASE(Slowdown);
+        if (draw_percent(m_slowdown_gen, RIGHT_LANE, m_position[k]) > RAND_DEC_TH) {
+            if (vehicle.get_speed() < m_max_speed) {
+                vehicle.accelerate();
+            }
+        }
+        else {
+            if (vehicle.get_speed() >= m_min_speed) {
+                vehicle.decelerate();
+            }
+        }
+
+        // Step 2: Check driving distance to the vehicle in front,
+        // already moved by the sequential rule, before the step by the synchronous one
+        PROFILE_PHASE(Gap);
+        PROFILE_COUNT(GapProbes);
+        uint32_t vehicle_new_pos = drive(vehicle, m_position[k], leader, leader_length);
+        if (m_update_rule == UpdateRule::Synchronous) {
+            leader = m_position[k];
+            leader_length = vehicle.length();
+        }
+
+        // Step 3: Move the vehicle, if new position is still in scope
+        PROFILE_PHASE(Move);
+        if (vehicle_new_pos < m_cell_count) {
+            // Collect data about the vehicle
+            num_vehicles += 1;
+            num_occupied_spaces += vehicle.length();
+            stats.avg_speed += vehicle.get_speed();
+
+            m_position[k] = vehicle_new_pos;
+            if (m_update_rule == UpdateRule::Sequential) {
+                leader = vehicle_new_pos;
+                leader_length = vehicle.length();
+            }
+        }
+        else {
+            // Vehicle left the road in the current time step,
+            // all vehicles in front of it have left as well
+            stats.flux += 1;
+            m_first = k + 1;
+        }
+    }
+    compact();
+
+    PROFILE_PHASE(Queue);
+    auto new_vehicle_pos = insert_vehicle_from_queue();
+    PROFILE_PHASE(Stats);
+    if (new_vehicle_pos >= 0) {
+        if (m_vehicles.size() > m_first && m_position.back() == static_cast<uint32_t>(new_vehicle_pos)) {
+            auto vehicle = m_vehicles.back();
+            num_vehicles++;
+            num_occupied_spaces += vehicle.length();
+            stats.avg_speed += vehicle.get_speed();
+        }
+    }
+    stats.avg_speed = num_vehicles > 0 ? stats.avg_speed / num_vehicles : 0;
+    stats.density = num_occupied_spaces / static_cast<float>(m_cell_count);
+    if (m_snapshots) {
+        PROFILE_PHASE(Snapshot);
+        stats.road_snapshot.resize(1);
+        to_str(stats.road_snapshot[RIGHT_LANE]);
+    }
+    else {
+        stats.road_snapshot.clear();
+    }
+    PROFILE_PHASE(Other);
+    m_step++;
+}
+
+void RoadVehicleList::reset(uint32_t max_speed, uint8_t two_lane_portion, StreamKey key) {
+    Road::reset(max_speed, two_lane_portion, key);
+    m_first = 0;
+    m_position.clear();
+    m_vehicles.clear();
+}
+
+bool RoadVehicleList::entry_free(uint8_t vehicle_length) {
+    // Same conditions as Road::lane_free_check for every cell of the new vehicle:
+    // no vehicle front within the vehicle, no bus or truck reaching into it from the cell in front
+    // and no truck from two cells in front
+    if (static_cast<uint32_t>(vehicle_length) + 1 >= m_cell_count) {
+        return false;
+    }
+    for (uint32_t k = m_vehicles.size(); k > m_first && m_position[k - 1] <= static_cast<uint32_t>(vehicle_length) + 1; --k) {
+        uint32_t position = m_position[k - 1];
+        uint8_t length = m_vehicles[k - 1].length();
+        if (position < vehicle_length ||
+            (position == vehicle_length && length > 1) ||
+            (position == static_cast<uint32_t>(vehicle_length) + 1 && length > 2)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void RoadVehicleList::place_at_entry(const Vehicle& vehicle) {
+    m_position.push_back(vehicle.length() - 1);
+    m_vehicles.push_back(vehicle);
+}
+
+void RoadVehicleList::compact() {
+    if (m_first == 0 || m_first * 2 < m_vehicles.size()) {
+        return;
+    }
+    m_position.erase(m_position.begin(), m_position.begin() + m_first);
+    m_vehicles.erase(m_vehicles.begin(), m_vehicles.begin() + m_first);
+    m_first = 0;
+}
+
+void RoadVehicleList::to_str(std::string& road_string) const {
+    road_string.clear();
+    int32_t i = m_cell_count - 1;
+    for (uint32_t k = m_first; k < m_vehicles.size(); ++k) {
+        if (static_cast<int32_t>(m_position[k]) > i) {
+            continue; // Hidden under the vehicle in front
+        }
+        road_string.append(i - m_position[k], '.');
+        m_vehicles[k].append_str(road_string);
+        i = m_position[k] - m_vehicles[k].length();
+    }
+    if (i >= 0) {
+        road_string.append(i + 1, '.');
+    }
+    std::reverse(road_string.begin(), road_string.end());
+}
+
+void RoadVehicleList::record(uint8_t, uint32_t space_stride, uint8_t* row) const {
+    std::fill(row, row + (m_cell_count + space_stride - 1) / space_stride, CELL_EMPTY);
+    for (uint32_t k = m_first; k < m_vehicles.size(); ++k) {
+        const auto& vehicle = m_vehicles[k];
+        uint32_t front = m_position[k];
+        uint32_t rear = front >= vehicle.length() - 1u ? front - (vehicle.length() - 1u) : 0;
+        // Same as the cell engine, a front wins over a body
+        for (uint32_t i = rear; i < front; ++i) {
+            if (i % space_stride == 0 && row[i / space_stride] == CELL_EMPTY) {
+                row[i / space_stride] = CELL_BODY;
+            }
+        }
+        if (front % space_stride == 0) {
+            row[front / space_stride] = cell_code(vehicle.get_vehicle_type(), vehicle.get_speed());
+        }
+    }
+}
+
+uint32_t RoadVehicleList::size() const {
+    return m_cell_count;
+}
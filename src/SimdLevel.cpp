@@ -0,0 +1,52 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 29-12-2023
+ * @file SimdLevel.cpp
+ */
+
+#include "include/SimdLevel.h"
+
+static SimdLevel& selected_level() {
+    static SimdLevel level = supported_simd_levels().front();
+    return level;
+}
+
+const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Avx512:
+            return "avx512";
+        case SimdLevel::Avx2:
+            return "avx2";
+        default:
+            return "portable";
+    }
+}
+
+std::vector<SimdLevel> supported_simd_levels() {
+    std::vector<SimdLevel> levels;
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        levels.push_back(SimdLevel::Avx512);
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        levels.push_back(SimdLevel::Avx2);
+    }
+#endif
+    levels.push_back(SimdLevel::Portable);
+    return levels;
+}
+
+SimdLevel simd_level() {
+    return selected_level();
+}
+
+bool select_simd_level(const std::string& name) {
+    for (auto level : supported_simd_levels()) {
+        if (name == simd_level_name(level)) {
+            selected_level() = level;
+            return true;
+        }
+    }
+    return false;
+}
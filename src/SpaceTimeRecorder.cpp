@@ -0,0 +1,89 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 20-12-2023
+ * @file SpaceTimeRecorder.cpp
+ */
+
+#include "include/SpaceTimeRecorder.h"
+#include "include/TrafficDataSinks.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+SpaceTimeRecorder::SpaceTimeRecorder(const std::filesystem::path& path, uint8_t lanes, uint32_t cells,
+                                     uint32_t time_stride, uint32_t space_stride)
+                                     : m_path(path), m_lanes(lanes), m_columns(0), m_time_stride(time_stride),
+                                     m_space_stride(space_stride), m_steps(0), m_rows(0) {
+    if (time_stride == 0 || space_stride == 0) {
+        throw std::invalid_argument("The strides of the space-time recording have to be positive");
+    }
+    if (cells == 0) {
+        throw std::invalid_argument("The space-time recording needs a road of at least one cell");
+    }
+    m_file.open(path, std::ios::binary);
+    if (!m_file) {
+        throw std::runtime_error("Cannot open output file " + path.string());
+    }
+    m_columns = (cells + space_stride - 1) / space_stride;
+    m_file << NpySink::npy_header("|u1", "(0, " + std::to_string(m_lanes) + ", " + std::to_string(m_columns) + ")");
+    // Whole rows only, so the block is never split in the middle of a step
+    size_t row_size = static_cast<size_t>(m_lanes) * m_columns;
+    m_block.reserve(std::max(row_size, BLOCK_SIZE / row_size * row_size));
+}
+
+void SpaceTimeRecorder::record(const Road& road) {
+    if (m_steps++ % m_time_stride != 0) {
+        return;
+    }
+    size_t row_size = static_cast<size_t>(m_lanes) * m_columns;
+    if (m_block.size() + row_size > m_block.capacity()) {
+        m_file.write(reinterpret_cast<const char*>(m_block.data()), m_block.size());
+        m_block.clear();
+        check(m_file, m_path);
+    }
+    size_t offset = m_block.size();
+    m_block.resize(offset + row_size);
+    for (uint8_t lane = 0; lane < m_lanes; ++lane) {
+        road.record(lane, m_space_stride, m_block.data() + offset + lane * m_columns);
+    }
+    m_rows++;
+}
+
+void SpaceTimeRecorder::finish() {
+    m_file.write(reinterpret_cast<const char*>(m_block.data()), m_block.size());
+    m_block.clear();
+    m_file.seekp(0);
+    m_file << NpySink::npy_header("|u1", "(" + std::to_string(m_rows) + ", " + std::to_string(m_lanes) + ", " +
+                                          std::to_string(m_columns) + ")");
+    m_file.close();
+    // A truncated matrix would still claim all rows in its header
+    check(m_file, m_path);
+
+    auto meta_path = m_path;
+    meta_path.replace_extension(".json");
+    std::ofstream meta(meta_path);
+    meta << "{\n";
+    meta << "  \"format\": \"space-time\",\n";
+    meta << "  \"shape\": [" << m_rows << ", " << static_cast<int>(m_lanes) << ", " << m_columns << "],\n";
+    meta << "  \"time_stride\": " << m_time_stride << ",\n";
+    meta << "  \"space_stride\": " << m_space_stride << ",\n";
+    meta << "  \"meters_per_cell\": " << Road::METERS_PER_CELL << ",\n";
+    meta << "  \"cell_codes\": {\"empty\": " << static_cast<int>(Road::CELL_EMPTY)
+         << ", \"no_lane\": " << static_cast<int>(Road::CELL_NO_LANE)
+         << ", \"body\": " << static_cast<int>(Road::CELL_BODY)
+         << ", \"front\": \"type << 4 | speed\", \"types\": [";
+    const auto& classes = VehicleClasses::table();
+    for (uint8_t type = 0; type < classes.size(); ++type) {
+        meta << (type ? ", " : "") << '"' << classes.names[type] << '"';
+    }
+    meta << "]}\n";
+    meta << "}\n";
+    meta.close();
+    check(meta, meta_path);
+}
+
+void SpaceTimeRecorder::check(const std::ofstream& file, const std::filesystem::path& path) {
+    if (!file) {
+        throw std::runtime_error("Writing the output file " + path.string() + " failed");
+    }
+}
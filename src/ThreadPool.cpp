@@ -0,0 +1,116 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 16-12-2023
+ * @file ThreadPool.cpp
+ */
+
+#include "include/ThreadPool.h"
+#include "include/Tracer.h"
+
+#include <algorithm>
+
+static thread_local uint32_t current_worker_index = ThreadPool::NOT_A_WORKER;
+
+ThreadPool::ThreadPool(uint32_t threads) : m_next_queue(0), m_pending(0), m_queued(0), m_stop(false) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (uint32_t i = 0; i < threads; ++i) {
+        m_queues.push_back(std::make_unique<TaskQueue>());
+    }
+    for (uint32_t i = 0; i < threads; ++i) {
+        m_workers.emplace_back(&ThreadPool::worker, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_task_ready.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    auto& queue = *m_queues[m_next_queue++ % m_queues.size()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending++;
+        m_queued++;
+    }
+    m_task_ready.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_all_done.wait(lock, [this] { return m_pending == 0; });
+}
+
+uint32_t ThreadPool::size() const {
+    return m_workers.size();
+}
+
+uint32_t ThreadPool::current_worker() {
+    return current_worker_index;
+}
+
+bool ThreadPool::take_task(uint32_t index, std::function<void()>& task) {
+    // Own queue first, newest task
+    {
+        auto& queue = *m_queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            return true;
+        }
+    }
+    // Steal the oldest task of another worker
+    for (uint32_t i = 1; i < m_queues.size(); ++i) {
+        auto& queue = *m_queues[(index + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::worker(uint32_t index) {
+    current_worker_index = index;
+    Tracer::set_thread_name("worker " + std::to_string(index));
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_task_ready.wait(lock, [this] { return m_stop || m_queued > 0; });
+            if (m_queued == 0) {
+                return; // Stopped and nothing left to do
+            }
+            m_queued--;
+        }
+        // A task is reserved for this worker, it is in one of the queues
+        std::function<void()> task;
+        while (!take_task(index, task)) {
+            std::this_thread::yield();
+        }
+        {
+            TraceSpan span("task", "thread pool");
+            task();
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_pending == 0) {
+                m_all_done.notify_all();
+            }
+        }
+    }
+}
@@ -0,0 +1,138 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 26-12-2023
+ * @file Tracer.cpp
+ */
+
+#include "include/Tracer.h"
+
+#include <chrono>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    const char* category;
+    uint64_t begin;
+    uint64_t end;
+    int64_t arg;
+};
+
+/**
+ * Spans of one thread, only the owning thread appends to it
+ */
+struct ThreadBuffer {
+    static const size_t INITIAL_CAPACITY = 1 << 14;
+
+    explicit ThreadBuffer(uint32_t id) : id(id) {
+        events.reserve(INITIAL_CAPACITY);
+    }
+
+    uint32_t id;
+    std::string name;
+    std::vector<TraceEvent> events;
+};
+
+std::mutex buffers_mutex;
+std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+thread_local ThreadBuffer* thread_buffer = nullptr;
+uint64_t trace_start = 0;
+
+/**
+ * Buffer of the calling thread, registered on the first use
+ */
+ThreadBuffer& own_buffer() {
+    if (!thread_buffer) {
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        buffers.push_back(std::make_unique<ThreadBuffer>(buffers.size()));
+        thread_buffer = buffers.back().get();
+    }
+    return *thread_buffer;
+}
+
+void write_string(std::ostream& output, const std::string& text) {
+    output << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            output << '\\';
+        }
+        output << c;
+    }
+    output << '"';
+}
+
+}
+
+std::atomic<bool> Tracer::s_enabled {false};
+uint32_t Tracer::s_step_interval = 1;
+
+void Tracer::enable(uint32_t step_interval) {
+    s_step_interval = step_interval > 0 ? step_interval : 1;
+    trace_start = now();
+    s_enabled = true;
+}
+
+uint64_t Tracer::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Tracer::record(const char* name, const char* category, uint64_t begin, uint64_t end, int64_t arg) {
+    own_buffer().events.push_back({name, category, begin, end, arg});
+}
+
+void Tracer::set_thread_name(const std::string& name) {
+    if (enabled()) {
+        own_buffer().name = name;
+    }
+}
+
+void Tracer::write(std::ostream& output) {
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    output << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    // Nanosecond resolution in microseconds, the default format would round long traces to a few digits
+    auto flags = output.flags();
+    auto precision = output.precision();
+    output << std::fixed << std::setprecision(3);
+    bool first = true;
+    for (const auto& buffer : buffers) {
+        if (!buffer->name.empty()) {
+            output << (first ? "" : ",\n") << R"({"ph": "M", "name": "thread_name", "pid": 1, "tid": )" << buffer->id
+                   << R"(, "args": {"name": )";
+            write_string(output, buffer->name);
+            output << "}}";
+            first = false;
+        }
+        for (const auto& event : buffer->events) {
+            // Complete events: the begin time and the duration in microseconds
+            output << (first ? "" : ",\n") << R"({"ph": "X", "pid": 1, "tid": )" << buffer->id
+                   << R"(, "name": ")" << event.name << R"(", "cat": ")" << event.category
+                   << R"(", "ts": )" << (event.begin - trace_start) / 1000.0
+                   << R"(, "dur": )" << (event.end - event.begin) / 1000.0;
+            if (event.arg >= 0) {
+                output << R"(, "args": {"value": )" << event.arg << "}";
+            }
+            output << "}";
+            first = false;
+        }
+    }
+    output << "\n]}\n";
+    output.flags(flags);
+    output.precision(precision);
+}
+
+TraceSession::TraceSession(const std::filesystem::path& path, uint32_t step_interval) : m_file(path) {
+    if (!m_file) {
+        throw std::runtime_error("Cannot open trace file " + path.string());
+    }
+    Tracer::enable(step_interval);
+    Tracer::set_thread_name("main");
+}
+
+TraceSession::~TraceSession() {
+    Tracer::write(m_file);
+}
@@ -5,9 +5,46 @@
  */
 
 #include "include/TrafficData.h"
-#include "include/RoadMap.h"
 
-TrafficData::TrafficData() {
+static const char CSV_DELIM = ';';
+static const std::vector<std::string> NO_SNAPSHOT {};
+
+std::string TrafficDataSink::csv_header(uint8_t lanes, bool snapshots) {
+    std::string csv {"avg_speed"};
+    csv += CSV_DELIM;
+    csv += "density";
+    csv += CSV_DELIM;
+    csv += "flux";
+    if (snapshots) {
+        csv += CSV_DELIM;
+        csv += "lane_right";
+        if (lanes > 1) {
+            csv += CSV_DELIM;
+            csv += "lane_left";
+        }
+    }
+    csv += '\n';
+    return csv;
+}
+
+void TrafficDataSink::append_csv_row(std::string& csv, float avg_speed, float density, float flux,
+                                     const std::vector<std::string>& road_snapshot) {
+    csv += std::to_string(avg_speed);
+    csv += CSV_DELIM;
+    csv += std::to_string(density);
+    csv += CSV_DELIM;
+    csv += std::to_string(flux);
+    for (const auto& lane : road_snapshot) {
+        csv += CSV_DELIM;
+        csv += lane;
+    }
+    if (!road_snapshot.empty()) {
+        csv += CSV_DELIM;
+    }
+    csv += '\n';
+}
+
+TrafficData::TrafficData(bool snapshots) : m_snapshots(snapshots) {
     m_avg_speed = std::vector<float>();
     m_flux = std::vector<float>();
     m_traffic_density = std::vector<float>();
@@ -15,49 +52,40 @@ TrafficData::TrafficData() {
     m_road_snapshot = std::vector<std::vector<std::string>>();
 }
 
+void TrafficData::begin(uint32_t steps) {
+    m_avg_speed.reserve(steps);
+    m_flux.reserve(steps);
+    m_traffic_density.reserve(steps);
+    if (m_snapshots) {
+        m_road_snapshot.reserve(steps);
+    }
+}
+
 void TrafficData::add_sample(const TrafficDataSample &sample) {
     m_avg_speed.push_back(sample.avg_speed);
     m_flux.push_back(sample.flux);
     m_traffic_density.push_back(sample.density);
-    m_road_snapshot.push_back(sample.road_snapshot);
+    if (m_snapshots) {
+        m_road_snapshot.push_back(sample.road_snapshot);
+    }
 }
 
-std::string OneLaneTrafficData::to_csv() const {
-    static const std::string delim {";"};
-    std::string csv {"avg_speed" + delim + "density" + delim + "flux" + delim + "lane_right" + '\n'};
+bool TrafficData::wants_snapshots() const {
+    return m_snapshots;
+}
 
+std::string OneLaneTrafficData::to_csv() const {
+    std::string csv = csv_header(1, m_snapshots);
     for (uint32_t i = 0; i < m_avg_speed.size(); ++i) {
-        csv += std::to_string(m_avg_speed[i]);
-        csv += delim;
-        csv += std::to_string(m_traffic_density[i]);
-        csv += delim;
-        csv += std::to_string(m_flux[i]);
-        csv += delim;
-        csv += m_road_snapshot[i][RIGHT_LANE];
-        csv += delim + '\n';
+        append_csv_row(csv, m_avg_speed[i], m_traffic_density[i], m_flux[i], m_snapshots ? m_road_snapshot[i] : NO_SNAPSHOT);
     }
-
     return csv;
 }
 
-
 std::string TwoLaneTrafficData::to_csv() const {
-    static const std::string delim {";"};
-    std::string csv {"avg_speed" + delim + "density" + delim + "flux" + delim + "lane_right" + delim + "lane_left" + '\n'};
-
+    std::string csv = csv_header(2, m_snapshots);
     for (uint32_t i = 0; i < m_avg_speed.size(); ++i) {
-        csv += std::to_string(m_avg_speed[i]);
-        csv += delim;
-        csv += std::to_string(m_traffic_density[i]);
-        csv += delim;
-        csv += std::to_string(m_flux[i]);
-        csv += delim;
-        csv += m_road_snapshot[i][RIGHT_LANE];
-        csv += delim;
-        csv += m_road_snapshot[i][LEFT_LANE];
-        csv += delim;
-        csv +='\n';
+        append_csv_row(csv, m_avg_speed[i], m_traffic_density[i], m_flux[i], m_snapshots ? m_road_snapshot[i] : NO_SNAPSHOT);
     }
     return csv;
 }
-
@@ -0,0 +1,173 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 19-12-2023
+ * @file TrafficDataSinks.cpp
+ */
+
+#include "include/TrafficDataSinks.h"
+#include "include/TrafficSimulator.h"
+
+#include <stdexcept>
+
+CsvSink::CsvSink(std::shared_ptr<BackgroundWriter> writer, uint8_t lanes, bool snapshots, bool header,
+                 std::optional<uint32_t> replica) : m_writer(std::move(writer)), m_snapshots(snapshots) {
+    if (replica.has_value()) {
+        m_prefix = std::to_string(replica.value()) + ';';
+    }
+    m_chunk.reserve(CHUNK_SIZE * 2);
+    if (header) {
+        m_chunk += replica.has_value() ? "replica;" : "";
+        m_chunk += csv_header(lanes, snapshots);
+    }
+}
+
+void CsvSink::add_sample(const TrafficDataSample& sample) {
+    m_chunk += m_prefix;
+    append_csv_row(m_chunk, sample.avg_speed, sample.density, sample.flux, sample.road_snapshot);
+    if (m_chunk.size() >= CHUNK_SIZE) {
+        m_writer->write(std::move(m_chunk));
+        m_chunk = m_writer->take_buffer();
+        // A row may end past the chunk size, leave room for it
+        m_chunk.reserve(CHUNK_SIZE * 2);
+    }
+}
+
+void CsvSink::finish() {
+    if (!m_chunk.empty()) {
+        m_writer->write(std::move(m_chunk));
+        m_chunk = std::string();
+    }
+}
+
+bool CsvSink::wants_snapshots() const {
+    return m_snapshots;
+}
+
+SummarySink::SummarySink() : m_samples(0), m_avg_speed(0), m_density(0), m_flux(0) {
+}
+
+void SummarySink::add_sample(const TrafficDataSample& sample) {
+    m_samples++;
+    m_avg_speed += sample.avg_speed;
+    m_density += sample.density;
+    m_flux += sample.flux;
+}
+
+bool SummarySink::wants_snapshots() const {
+    return false;
+}
+
+float SummarySink::avg_speed() const {
+    return m_samples > 0 ? m_avg_speed / m_samples : 0;
+}
+
+float SummarySink::density() const {
+    return m_samples > 0 ? m_density / m_samples : 0;
+}
+
+float SummarySink::flux() const {
+    return m_samples > 0 ? m_flux / m_samples : 0;
+}
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "The .npy columns are written as little-endian floats");
+
+const std::array<const char*, NpySink::COLUMNS> NpySink::COLUMN_NAMES {"avg_speed", "density", "flux"};
+
+NpySink::NpySink(const std::filesystem::path& directory, const SimulationParameters& parameters, StreamKey key)
+                : m_directory(directory), m_key(key), m_samples(0) {
+    std::filesystem::create_directories(m_directory);
+    for (size_t c = 0; c < COLUMNS; ++c) {
+        auto path = m_directory / (std::string(COLUMN_NAMES[c]) + ".npy");
+        m_files[c].open(path, std::ios::binary);
+        if (!m_files[c]) {
+            throw std::runtime_error("Cannot open output file " + path.string());
+        }
+        // The length is filled in by finish(), the header keeps its size
+        m_files[c] << npy_header("<f4", "(0,)");
+        m_block[c].reserve(BLOCK_SAMPLES);
+    }
+
+    m_parameters = "{\"type\": \"";
+    m_parameters += parameters.type == SimType::TwoLane ? "two-lane" : "one-lane";
+    m_parameters += "\", \"engine\": \"";
+    m_parameters += engine_name(parameters.engine);
+    m_parameters += "\", \"update_rule\": \"";
+    m_parameters += update_rule_name(parameters.update_rule);
+    m_parameters += "\", \"road_length_m\": " + std::to_string(parameters.road_length_m);
+    m_parameters += ", \"arrival_interval\": " + std::to_string(parameters.arrival_interval);
+    m_parameters += ", \"max_speed_ms\": " + std::to_string(parameters.max_speed_ms);
+    m_parameters += ", \"two_lane_portion\": " + std::to_string(parameters.left_lane_portion);
+    for (size_t type = 0; type < parameters.portions.size(); ++type) {
+        m_parameters += ", \"" + VehicleClasses::table().names[type] + "\": " + std::to_string(parameters.portions[type]);
+    }
+    m_parameters += "}";
+}
+
+void NpySink::add_sample(const TrafficDataSample& sample) {
+    m_block[0].push_back(sample.avg_speed);
+    m_block[1].push_back(sample.density);
+    m_block[2].push_back(sample.flux);
+    m_samples++;
+    if (m_block[0].size() == BLOCK_SAMPLES) {
+        flush_block();
+    }
+}
+
+void NpySink::flush_block() {
+    for (size_t c = 0; c < COLUMNS; ++c) {
+        m_files[c].write(reinterpret_cast<const char*>(m_block[c].data()), m_block[c].size() * sizeof(float));
+        m_block[c].clear();
+        check(m_files[c], std::string(COLUMN_NAMES[c]) + ".npy");
+    }
+}
+
+void NpySink::finish() {
+    flush_block();
+    for (size_t c = 0; c < COLUMNS; ++c) {
+        m_files[c].seekp(0);
+        m_files[c] << npy_header("<f4", "(" + std::to_string(m_samples) + ",)");
+        m_files[c].close();
+        // A truncated column would still claim all samples in its header
+        check(m_files[c], std::string(COLUMN_NAMES[c]) + ".npy");
+    }
+
+    std::ofstream meta(m_directory / "meta.json");
+    meta << "{\n";
+    meta << "  \"format\": \"npy-columns\",\n";
+    meta << "  \"columns\": [";
+    for (size_t c = 0; c < COLUMNS; ++c) {
+        meta << (c > 0 ? ", " : "") << "{\"name\": \"" << COLUMN_NAMES[c] << "\", \"file\": \"" << COLUMN_NAMES[c]
+             << ".npy\", \"dtype\": \"<f4\"}";
+    }
+    meta << "],\n";
+    meta << "  \"samples\": " << m_samples << ",\n";
+    meta << "  \"seed\": " << m_key.seed << ",\n";
+    meta << "  \"replica\": " << m_key.replica + 1 << ",\n";
+    meta << "  \"parameters\": " << m_parameters << "\n";
+    meta << "}\n";
+    meta.close();
+    check(meta, "meta.json");
+}
+
+void NpySink::check(const std::ofstream& file, const std::string& name) const {
+    if (!file) {
+        throw std::runtime_error("Writing the output file " + (m_directory / name).string() + " failed");
+    }
+}
+
+bool NpySink::wants_snapshots() const {
+    return false;
+}
+
+std::string NpySink::npy_header(const std::string& descr, const std::string& shape) {
+    // Format version 1.0: magic, version, little-endian header length and a python dict padded with spaces
+    std::string dict = "{'descr': '" + descr + "', 'fortran_order': False, 'shape': " + shape + ", }";
+    size_t header_length = NPY_HEADER_SIZE - 10;
+    dict.resize(header_length - 1, ' ');
+    dict += '\n';
+
+    std::string header {"\x93NUMPY\x01\x00", 8};
+    header += static_cast<char>(header_length & 0xFF);
+    header += static_cast<char>(header_length >> 8);
+    return header + dict;
+}
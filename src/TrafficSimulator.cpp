@@ -5,73 +5,227 @@
  */
 
 #include "include/TrafficSimulator.h"
-#include <chrono>
-#include <thread>
+#include "include/RoadVehicleList.h"
+#include "include/RoadMapParallel.h"
+#include "include/RoadSimd.h"
+#include "include/RoadReplicas.h"
+#include "include/RoadBitSliced.h"
+#include "include/Tracer.h"
+#include <algorithm>
 #include <random>
 #include <iostream>
 
-TrafficSimulator::TrafficSimulator(int car_portion, int bus_portion, int truck_portion, int arrival_interval,
-                                   int max_speed_ms, int road_length_m, SimType type, int left_lane_portion)
-                                           : m_car_portion(car_portion), m_bus_portion(bus_portion),
-                                           m_truck_portion(truck_portion), m_max_speed(max_speed_ms),
-                                           m_arrival_interval(arrival_interval){
-    std::random_device rd;
-    m_gen = std::mt19937(rd());
-    switch (type) {
-        case SimType::OneLane:
-            m_road = std::make_unique<RoadMap>(road_length_m, m_max_speed);
-            m_stats = std::make_shared<OneLaneTrafficData>();
-        break;
-        case SimType::TwoLane:
-            m_road = std::make_unique<RoadMapTwoLane>(road_length_m, max_speed_ms, left_lane_portion);
-            m_stats = std::make_shared<TwoLaneTrafficData>();
+const char* engine_name(RoadEngine engine) {
+    switch (engine) {
+        case RoadEngine::VehicleList:
+            return "vehicle-list";
+        case RoadEngine::Parallel:
+            return "parallel";
+        case RoadEngine::Simd:
+            return "simd";
+        case RoadEngine::Replicas:
+            return "replicas";
+        case RoadEngine::BitSliced:
+            return "bitsliced";
+        default:
+            return "cells";
     }
 }
 
-std::shared_ptr<TrafficData> TrafficSimulator::simulate(int seconds, float speed_up_ratio = 1) {
-    std::exponential_distribution<> gen_next_arrival_time(1.f / m_arrival_interval);
-    std::uniform_int_distribution<int> gen_init_speed(2, 5);
-    std::uniform_int_distribution<int> gen_vehicle_type(1, 1000);
+const char* update_rule_name(UpdateRule rule) {
+    return rule == UpdateRule::Synchronous ? "synchronous" : "sequential";
+}
+
+ArrivalProcess::ArrivalProcess(const SimulationParameters& parameters, Philox& gen)
+                                           : m_gen(gen), m_gen_next_arrival_time(1.f / parameters.arrival_interval),
+                                           m_gen_init_speed(2, 5),
+                                           m_vehicle_types(cars_only(parameters) ? std::vector<int> {1} : parameters.portions) {
+    m_next_arrival = m_gen_next_arrival_time(m_gen);
+    m_vehicle_type = static_cast<vt_t>(m_vehicle_types.sample(m_gen()));
+    // An unused initial speed is drawn ahead of the first arrival, it keeps the streams of earlier runs
+    m_gen_init_speed(m_gen);
+}
+
+std::optional<Vehicle> ArrivalProcess::arrival(int step) {
+    if (step != m_next_arrival) {
+        return std::nullopt;
+    }
+    int initial_speed = m_gen_init_speed(m_gen);
+    // One cell vehicles, like the cars, arrive one cell per second faster
+    std::optional<Vehicle> vehicle;
+    vehicle.emplace(m_vehicle_type, Vehicle::length_of(m_vehicle_type) == 1 ? initial_speed + 1 : initial_speed);
+    m_next_arrival = step + 1 + m_gen_next_arrival_time(m_gen);
+    m_vehicle_type = static_cast<vt_t>(m_vehicle_types.sample(m_gen()));
+    return vehicle;
+}
+
+bool ArrivalProcess::cars_only(const SimulationParameters& parameters) {
+    return std::all_of(parameters.portions.begin() + 1, parameters.portions.end(), [](int portion) {
+        return portion == 0;
+    });
+}
 
-    std::string road_boundary = std::string(m_road->size(), '-');
-    int next_arrival = gen_next_arrival_time(m_gen);
-    int vehicle_type = gen_vehicle_type(m_gen);
-    int initial_speed = gen_init_speed(m_gen);
+/**
+ * Configuration of the cells engine for the parameters
+ */
+static CellsConfig cells_config(const SimulationParameters& parameters) {
+    return {static_cast<uint8_t>(parameters.type == SimType::TwoLane ? 2 : 1), parameters.update_rule,
+            ArrivalProcess::cars_only(parameters)};
+}
 
+TrafficSimulator::TrafficSimulator(const SimulationParameters& parameters, StreamKey key)
+                                           : m_parameters(parameters), m_render_interval(1), m_key(key),
+                                           m_gen(key, RandomStream::Arrivals),
+                                           m_recorder(nullptr) {
+    make_road();
+}
+
+void TrafficSimulator::make_road() {
+    switch (m_parameters.engine) {
+        case RoadEngine::VehicleList:
+            m_road = std::make_unique<RoadVehicleList>(m_parameters.road_length_m, m_parameters.max_speed_ms, m_key);
+            break;
+        case RoadEngine::Simd:
+            m_road = std::make_unique<RoadSimd>(m_parameters.road_length_m, m_parameters.max_speed_ms, m_key);
+            break;
+        case RoadEngine::Parallel:
+            m_road = std::make_unique<RoadMapParallel>(m_parameters.road_length_m, m_parameters.max_speed_ms, m_key, m_parameters.engine_threads);
+            break;
+        default:
+            // The update of the cells engine is specialised for the configuration, it is picked from its dispatch table
+            m_road = make_cells_road(cells_config(m_parameters), m_parameters.road_length_m, m_parameters.max_speed_ms,
+                                     m_parameters.left_lane_portion, m_key);
+    }
+    m_road->set_update_rule(m_parameters.update_rule);
+}
+
+void TrafficSimulator::simulate(int seconds, Pacer& pacer, TrafficDataSink& sink) {
+    ArrivalProcess arrivals(m_parameters, m_gen);
+    std::string road_boundary {};
+    std::string frame {};
+    if (m_render_interval > 0) {
+        road_boundary = std::string(m_road->size(), '-');
+    }
+
+    m_road->set_snapshots(sink.wants_snapshots());
+    sink.begin(seconds);
+    PROFILE_RESET();
+
+    TraceSpan run_span("simulate", "simulation", true, seconds);
+    pacer.start();
     for (int i = 0; i < seconds; ++i) {
+        bool traced = Tracer::sampled(i);
+        TraceSpan step_span("step", "simulation", traced, i);
         // Insert car
-        if (i == next_arrival) {
-            initial_speed = gen_init_speed(m_gen);
-            if (vehicle_type < m_car_portion){
-                // Crete a car
-                m_road->insert(Vehicle(vt_t::car, initial_speed + 1));
-            }
-            else if (vehicle_type < m_car_portion + m_bus_portion) {
-                // Crete a bus
-                m_road->insert(Vehicle(vt_t::bus, initial_speed));
-            }
-            else {
-                // Create a truck
-                m_road->insert(Vehicle(vt_t::truck, initial_speed));
-            }
-            next_arrival = i + 1 + gen_next_arrival_time(m_gen);
-            vehicle_type = gen_vehicle_type(m_gen);
+        if (auto vehicle = arrivals.arrival(i)) {
+            m_road->insert(*vehicle);
         }
 
-        std::cout << road_boundary << '\n';
-        std::cout << m_road->to_str() << '\n';
-        std::cout << road_boundary << '\n';
+        bool render = m_render_interval > 0 && i % m_render_interval == 0;
+        if (render) {
+            std::cout << road_boundary << '\n';
+            m_road->to_str(frame);
+            std::cout << frame << '\n';
+            std::cout << road_boundary << '\n';
+        }
 
         // Update model and save data
-        auto step_stats = m_road->update();
-        m_stats->add_sample(step_stats);
+        {
+            TraceSpan update_span("update", "simulation", traced);
+            m_road->update(m_sample);
+        }
+        sink.add_sample(m_sample);
+        if (m_recorder) {
+            m_recorder->record(*m_road);
+        }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<int>(1000/speed_up_ratio)));
-        std::cout << std::flush;
+        pacer.step();
+        if (render) {
+            std::cout << std::flush;
+        }
+    }
+    sink.finish();
+    if (m_recorder) {
+        m_recorder->finish();
     }
-    return m_stats;
+    PROFILE_REPORT(std::cout, seconds);
+}
+
+void TrafficSimulator::set_render_interval(int steps_per_frame) {
+    m_render_interval = steps_per_frame;
+}
+
+void TrafficSimulator::set_recorder(SpaceTimeRecorder* recorder) {
+    m_recorder = recorder;
 }
 
 void TrafficSimulator::reset() {
-    m_road = std::make_unique<RoadMap>(m_road->size(), m_max_speed);
-}
\ No newline at end of file
+    m_road->reset(m_parameters.max_speed_ms, m_parameters.left_lane_portion, m_key);
+    m_gen = Philox(m_key, RandomStream::Arrivals);
+}
+
+void TrafficSimulator::reconfigure(const SimulationParameters& parameters, StreamKey key) {
+    bool same_road = cells_config(parameters) == cells_config(m_parameters);
+    m_parameters = parameters;
+    m_key = key;
+    if (!same_road) {
+        // Another specialisation of the cells engine, e.g. the swept vehicle portions leave cars only
+        make_road();
+    }
+    reset();
+}
+
+ReplicaSimulator::ReplicaSimulator(const SimulationParameters& parameters, uint64_t seed, uint32_t first_replica, uint32_t replicas)
+                                   : m_parameters(parameters) {
+    if (m_parameters.engine == RoadEngine::BitSliced) {
+        m_road = std::make_unique<RoadBitSliced>(m_parameters.road_length_m, m_parameters.max_speed_ms, seed, first_replica, replicas);
+    }
+    else {
+        m_road = std::make_unique<RoadReplicas>(m_parameters.road_length_m, m_parameters.max_speed_ms, seed, first_replica, replicas);
+    }
+    m_road->set_update_rule(m_parameters.update_rule);
+    for (uint32_t road = 0; road < replicas; ++road) {
+        m_gens.emplace_back(StreamKey {seed, first_replica + road}, RandomStream::Arrivals);
+    }
+}
+
+uint32_t ReplicaSimulator::width(RoadEngine engine) {
+    return engine == RoadEngine::BitSliced ? RoadBitSliced::WIDTH : RoadReplicas::WIDTH;
+}
+
+void ReplicaSimulator::simulate(int seconds, const std::vector<TrafficDataSink*>& sinks) {
+    // The processes keep references to the generators, which are not reallocated anymore
+    std::vector<ArrivalProcess> arrivals;
+    for (auto& gen : m_gens) {
+        arrivals.emplace_back(m_parameters, gen);
+    }
+    bool snapshots = false;
+    for (auto sink : sinks) {
+        snapshots |= sink->wants_snapshots();
+        sink->begin(seconds);
+    }
+    m_road->set_snapshots(snapshots);
+    PROFILE_RESET();
+
+    TraceSpan run_span("simulate", "simulation", true, seconds);
+    for (int i = 0; i < seconds; ++i) {
+        bool traced = Tracer::sampled(i);
+        TraceSpan step_span("step", "simulation", traced, i);
+        for (uint32_t road = 0; road < m_road->replicas(); ++road) {
+            if (auto vehicle = arrivals[road].arrival(i)) {
+                m_road->insert(road, *vehicle);
+            }
+        }
+        {
+            TraceSpan update_span("update", "simulation", traced);
+            m_road->update(m_samples);
+        }
+        for (uint32_t road = 0; road < m_road->replicas(); ++road) {
+            sinks[road]->add_sample(m_samples[road]);
+        }
+    }
+    for (auto sink : sinks) {
+        sink->finish();
+    }
+    PROFILE_REPORT(std::cout, seconds);
+}
@@ -0,0 +1,139 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 31-12-2023
+ * @file VehicleClasses.cpp
+ */
+
+#include "include/VehicleClasses.h"
+#include "include/Vehicle.h"
+#include "include/traffic_simulation.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+VehicleClasses VehicleClasses::s_table = VehicleClasses::builtin();
+
+namespace {
+
+const char* const HEADER = "name,symbol,length,acceleration,deceleration,portion";
+
+/**
+ * Read a line, without the carriage return of files exported on Windows
+ */
+bool read_line(std::istream& input, std::string& line) {
+    if (!std::getline(input, line)) {
+        return false;
+    }
+    if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+    }
+    return true;
+}
+
+template <typename T>
+T parse_field(const std::string& value, const std::string& field, int line) {
+    std::istringstream stream(value);
+    T result;
+    if (!(stream >> result) || !stream.eof()) {
+        throw std::invalid_argument("Invalid " + field + " '" + value + "' on line " + std::to_string(line) + " of the vehicle classes");
+    }
+    return result;
+}
+
+}
+
+VehicleClasses VehicleClasses::builtin() {
+    VehicleClasses classes;
+    classes.add("cars", ' ', 1, 0.14f, 0.52f, CAR_PORTION_RATIO);
+    classes.add("buses", 'B', 2, 0.05f, 0.1f, BUS_PORTION_RATIO);
+    classes.add("trucks", 'T', 3, 0.04f, 0.09f, TRUCK_PORTION_RATIO);
+    return classes;
+}
+
+void VehicleClasses::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Cannot open vehicle classes " + path);
+    }
+    std::string row;
+    if (!read_line(file, row) || row != HEADER) {
+        throw std::invalid_argument("Vehicle classes have to start with the header " + std::string(HEADER));
+    }
+
+    VehicleClasses classes;
+    for (int line = 2; read_line(file, row); ++line) {
+        if (row.empty()) {
+            continue;
+        }
+        std::vector<std::string> fields;
+        std::istringstream columns(row);
+        std::string field;
+        while (std::getline(columns, field, ',')) {
+            fields.push_back(field);
+        }
+        if (row.back() == ',') {
+            fields.emplace_back();
+        }
+        if (fields.size() != 6) {
+            throw std::invalid_argument("Line " + std::to_string(line) + " of the vehicle classes does not have 6 fields");
+        }
+        if (fields[1].size() > 1) {
+            throw std::invalid_argument("Symbol of the class on line " + std::to_string(line) + " has to be a single character");
+        }
+        classes.add(fields[0], fields[1].empty() ? ' ' : fields[1][0], parse_field<int>(fields[2], "length", line),
+                    parse_field<float>(fields[3], "acceleration", line), parse_field<float>(fields[4], "deceleration", line),
+                    parse_field<int>(fields[5], "portion", line));
+    }
+    if (classes.size() == 0) {
+        throw std::invalid_argument("No vehicle classes in " + path);
+    }
+    if (classes.length[0] != 1) {
+        throw std::invalid_argument("The first vehicle class has to be one cell long, it is taken as the car");
+    }
+    s_table = classes;
+}
+
+int VehicleClasses::find(const std::string& name) const {
+    auto found = std::find(names.begin(), names.end(), name);
+    return found == names.end() ? -1 : static_cast<int>(found - names.begin());
+}
+
+void VehicleClasses::add(const std::string& name, char class_symbol, int class_length, float class_acceleration,
+                         float class_deceleration, int class_portion) {
+    if (size() == MAX_CLASSES) {
+        throw std::invalid_argument("At most " + std::to_string(MAX_CLASSES) + " vehicle classes are supported");
+    }
+    bool valid_name = !name.empty() && std::all_of(name.begin(), name.end(), [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_';
+    });
+    if (!valid_name || find(name) >= 0) {
+        throw std::invalid_argument("Vehicle class name '" + name + "' is empty, not unique or has other characters than letters, digits, - and _");
+    }
+    if (class_length < 1 || class_length > MAX_LENGTH) {
+        throw std::invalid_argument("Vehicle class " + name + " has to be 1 to " + std::to_string(MAX_LENGTH) + " cells long");
+    }
+    // The rendered road has one character per cell, the symbol must not look like a speed or an empty cell
+    if (class_length > 1 && (std::isdigit(static_cast<unsigned char>(class_symbol)) || class_symbol == ' ' ||
+                             class_symbol == '.' || class_symbol == '#')) {
+        throw std::invalid_argument("Vehicle class " + name + " needs a symbol other than a digit, '.' or '#'");
+    }
+    // The measured classes change their speed by a fraction of a cell per step, larger values are likely in m/s^2
+    if (!(class_acceleration > 0 && class_acceleration < 1 && class_deceleration > 0 && class_deceleration < 1) ||
+        Vehicle::fixed_speed(class_acceleration) == 0 || Vehicle::fixed_speed(class_acceleration) > Vehicle::SPEED_FRACTION_MASK ||
+        Vehicle::fixed_speed(class_deceleration) == 0 || Vehicle::fixed_speed(class_deceleration) > Vehicle::SPEED_FRACTION_MASK) {
+        throw std::invalid_argument("Acceleration and deceleration of vehicle class " + name + " have to be between 0 and 1 cell/s^2");
+    }
+    if (class_portion < 0) {
+        throw std::invalid_argument("Portion of vehicle class " + name + " cannot be negative");
+    }
+    uint8_t index = size();
+    acceleration[index] = Vehicle::fixed_speed(class_acceleration);
+    deceleration[index] = Vehicle::fixed_speed(class_deceleration);
+    length[index] = static_cast<uint8_t>(class_length);
+    symbol[index] = class_symbol;
+    portion[index] = class_portion;
+    names.push_back(name);
+}
@@ -0,0 +1,46 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 31-12-2023
+ * @file AliasTable.h
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Discrete distribution sampled in constant time by Walker's alias method
+ * Every column holds the probability of its own outcome and an alias taking the rest of the column,
+ * a sample picks a column and decides between the two by a single comparison. The table is built
+ * from integer weights with integer arithmetic, so it is the same on every platform.
+ */
+class AliasTable {
+public:
+    /**
+     * @param weights relative weights of the outcomes
+     * @throws std::invalid_argument if there are no weights, a negative one or their sum is zero
+     */
+    explicit AliasTable(const std::vector<int>& weights);
+
+    /**
+     * Outcome for a uniformly distributed 32 bit number
+     * The upper part of number * size picks the column, the lower 32 bits are the uniform fraction within it.
+     */
+    uint32_t sample(uint32_t random) const {
+        uint64_t scaled = static_cast<uint64_t>(random) * m_threshold.size();
+        uint32_t column = static_cast<uint32_t>(scaled >> 32);
+        return static_cast<uint32_t>(scaled) < m_threshold[column] ? column : m_alias[column];
+    }
+
+    uint32_t size() const {
+        return static_cast<uint32_t>(m_threshold.size());
+    }
+
+private:
+    /**
+     * Probability of the column's own outcome as a fraction of 2^32, 2^32 if it has no alias
+     */
+    std::vector<uint64_t> m_threshold;
+    std::vector<uint32_t> m_alias;
+};
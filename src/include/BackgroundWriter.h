@@ -0,0 +1,97 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 19-12-2023
+ * @file BackgroundWriter.h
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "RingBuffer.h"
+
+/**
+ * Writes chunks of output on a separate thread
+ * Producers hand over whole chunks and continue with the simulation.
+ * The number of chunks waiting to be written is bounded, so the memory
+ * used by the output does not grow with the length of the simulation.
+ * Chunks from several producers are written whole, in the order they were handed over.
+ * Written chunks are kept for reuse, so a producer which takes its buffers
+ * from take_buffer() does not allocate once the writer is warmed up.
+ * A failed write, e.g. on a full disk, drops the rest of the output. It is reported by close()
+ * and by failed(), as the writers are often destroyed on the threads of the replications.
+ */
+class BackgroundWriter {
+public:
+    /**
+     * Write into an existing stream, the stream has to outlive the writer
+     * @param max_pending chunks which may wait for writing before producers are blocked
+     */
+    explicit BackgroundWriter(std::ostream& output, size_t max_pending = 16);
+
+    /**
+     * Write into a newly created file
+     * @throws std::runtime_error if the file cannot be opened
+     */
+    explicit BackgroundWriter(const std::filesystem::path& path, size_t max_pending = 16);
+
+    ~BackgroundWriter();
+
+    BackgroundWriter(const BackgroundWriter&) = delete;
+
+    BackgroundWriter& operator=(const BackgroundWriter&) = delete;
+
+    void write(std::string chunk);
+
+    /**
+     * Get an empty buffer for the next chunk, the storage of an already written chunk if there is one
+     */
+    std::string take_buffer();
+
+    /**
+     * Write all pending chunks, flush the output and stop the thread
+     * @throws std::runtime_error if writing the output failed
+     */
+    void close();
+
+    /**
+     * Whether writing failed in any writer of the process
+     */
+    static bool failed();
+
+private:
+    /**
+     * Write all pending chunks and stop the thread, the destructor does not throw
+     */
+    void stop();
+
+    void run();
+
+    std::ofstream m_file;
+    std::ostream& m_output;
+    size_t m_max_pending;
+    RingBuffer<std::string> m_pending;
+    /**
+     * Storage of the written chunks
+     */
+    std::vector<std::string> m_spare;
+    std::mutex m_mutex;
+    std::condition_variable m_changed;
+    bool m_closing;
+    /**
+     * Set by the writer thread, read after it has been joined
+     */
+    bool m_failed;
+    std::thread m_thread;
+
+    static std::atomic<bool> s_failed;
+};
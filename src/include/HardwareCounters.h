@@ -0,0 +1,74 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 24-12-2023
+ * @file HardwareCounters.h
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+/**
+ * Hardware performance counters of the calling thread read through Linux perf_event_open
+ * The counters are opened as one group, so all of them are read with a single system call.
+ * Events which the CPU, the kernel or its perf_event_paranoid setting do not allow are
+ * left out; if none can be opened, the counters are unavailable and read nothing.
+ */
+class HardwareCounters {
+public:
+    enum Event {
+        Cycles,
+        Instructions,
+        L1DMisses,
+        LLCMisses,
+        BranchMisses,
+        EVENT_COUNT
+    };
+
+    using Values = std::array<uint64_t, EVENT_COUNT>;
+
+    static const std::array<const char*, EVENT_COUNT> EVENT_NAMES;
+
+    /**
+     * Open and start the counters of the calling thread
+     */
+    HardwareCounters();
+
+    ~HardwareCounters();
+
+    HardwareCounters(const HardwareCounters&) = delete;
+
+    HardwareCounters& operator=(const HardwareCounters&) = delete;
+
+    bool available() const {
+        return m_leader >= 0;
+    }
+
+    bool has(Event event) const {
+        return m_slot[event] >= 0;
+    }
+
+    /**
+     * Why the counters or some of them could not be opened, empty if all are open
+     */
+    const std::string& error() const {
+        return m_error;
+    }
+
+    /**
+     * Current values since the counters were opened, 0 for the events which are not open
+     */
+    Values read() const;
+
+private:
+    int m_leader;
+    std::array<int, EVENT_COUNT> m_fd;
+    /**
+     * Position of the event in the group read, -1 if it is not open
+     */
+    std::array<int, EVENT_COUNT> m_slot;
+    int m_open;
+    std::string m_error;
+};
@@ -0,0 +1,178 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 12-12-2023
+ * @file Lane.h
+ */
+
+#pragma once
+
+#include "Vehicle.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Packed storage of a single lane
+ * Cells are stored as parallel arrays of vehicle types and speeds,
+ * all other vehicle parameters are derived from the type.
+ * One cell takes 5 bytes instead of a whole optional Vehicle.
+ *
+ * Next to the arrays, the lane keeps occupancy bitmaps with one bit per cell:
+ * the fronts of all vehicles and the fronts of vehicles reaching one or two cells back.
+ * Searches for the next vehicle and free space checks work on whole 64-bit words.
+ */
+class Lane {
+public:
+    /**
+     * Type code of a cell without a vehicle
+     */
+    static constexpr uint8_t EMPTY_CELL = 0xFF;
+
+    static constexpr uint32_t WORD_BITS = 64;
+
+    Lane() = default;
+
+    explicit Lane(uint32_t cells);
+
+    /**
+     * Remove all vehicles from the lane
+     */
+    void reset();
+
+    /**
+     * Remove all vehicles from the cells first..end-1
+     * Both bounds have to be multiples of WORD_BITS (end may be the size of the lane),
+     * so that the range shares no bitmap word with the rest of the lane
+     */
+    void reset(uint32_t first, uint32_t end);
+
+    uint32_t size() const {
+        return m_type.size();
+    }
+
+    bool occupied(uint32_t cell) const {
+        return m_type[cell] != EMPTY_CELL;
+    }
+
+    /**
+     * Check whether a vehicle with its front in the cell covers the given number of cells behind it
+     * @param cell front of the vehicle
+     * @param cells 1 or 2
+     */
+    bool reaches_back(uint32_t cell, uint8_t cells) const {
+        return (m_reach[cells - 1][cell / WORD_BITS] >> (cell % WORD_BITS)) & 1;
+    }
+
+    /**
+     * Check whether there is a vehicle front in the cells first..last (inclusive)
+     */
+    bool any_occupied(uint32_t first, uint32_t last) const {
+        uint32_t first_word = first / WORD_BITS;
+        uint32_t last_word = last / WORD_BITS;
+        uint64_t first_mask = ~uint64_t(0) << (first % WORD_BITS);
+        uint64_t last_mask = ~uint64_t(0) >> (WORD_BITS - 1 - last % WORD_BITS);
+        if (first_word == last_word) {
+            return m_heads[first_word] & first_mask & last_mask;
+        }
+        if (m_heads[first_word] & first_mask) {
+            return true;
+        }
+        for (uint32_t w = first_word + 1; w < last_word; ++w) {
+            if (m_heads[w]) {
+                return true;
+            }
+        }
+        return m_heads[last_word] & last_mask;
+    }
+
+    /**
+     * Find the first vehicle front at the cell or in front of it
+     * @return cell of the vehicle front, int_max if there is none
+     */
+    int32_t next_occupied(int32_t from) const {
+        if (from >= static_cast<int32_t>(size())) {
+            return INT32_MAX;
+        }
+        uint32_t w = from / WORD_BITS;
+        uint64_t word = m_heads[w] & (~uint64_t(0) << (from % WORD_BITS));
+        while (!word) {
+            if (++w == m_heads.size()) {
+                return INT32_MAX;
+            }
+            word = m_heads[w];
+        }
+        return w * WORD_BITS + __builtin_ctzll(word);
+    }
+
+    /**
+     * Find the first vehicle front at the cell or behind it
+     * @return cell of the vehicle front, -1 if there is none
+     */
+    int32_t prev_occupied(int32_t from) const {
+        if (from < 0) {
+            return -1;
+        }
+        uint32_t w = from / WORD_BITS;
+        uint64_t word = m_heads[w] & (~uint64_t(0) >> (WORD_BITS - 1 - from % WORD_BITS));
+        while (!word) {
+            if (w-- == 0) {
+                return -1;
+            }
+            word = m_heads[w];
+        }
+        return w * WORD_BITS + WORD_BITS - 1 - __builtin_clzll(word);
+    }
+
+    /**
+     * Get the vehicle in the cell
+     * The cell has to be occupied
+     */
+    Vehicle get(uint32_t cell) const {
+        return Vehicle::restore(static_cast<vt_t>(m_type[cell]), m_speed[cell]);
+    }
+
+    /**
+     * Get the length of the vehicle in the cell
+     * The cell has to be occupied
+     */
+    uint8_t length(uint32_t cell) const {
+        return Vehicle::length_of(static_cast<vt_t>(m_type[cell]));
+    }
+
+    void set(uint32_t cell, const Vehicle& vehicle) {
+        m_type[cell] = static_cast<uint8_t>(vehicle.get_vehicle_type());
+        m_speed[cell] = vehicle.get_raw_speed();
+        set_bit(m_heads, cell, true);
+        set_bit(m_reach[0], cell, vehicle.length() > 1);
+        set_bit(m_reach[1], cell, vehicle.length() > 2);
+    }
+
+    void clear(uint32_t cell) {
+        m_type[cell] = EMPTY_CELL;
+        set_bit(m_heads, cell, false);
+        set_bit(m_reach[0], cell, false);
+        set_bit(m_reach[1], cell, false);
+    }
+
+private:
+    static void set_bit(std::vector<uint64_t>& bits, uint32_t cell, bool value) {
+        uint64_t mask = uint64_t(1) << (cell % WORD_BITS);
+        if (value) {
+            bits[cell / WORD_BITS] |= mask;
+        }
+        else {
+            bits[cell / WORD_BITS] &= ~mask;
+        }
+    }
+
+    std::vector<uint8_t> m_type;
+    std::vector<speed_t> m_speed;
+    /**
+     * Fronts of all vehicles
+     */
+    std::vector<uint64_t> m_heads;
+    /**
+     * Fronts of vehicles longer than one and two cells
+     */
+    std::vector<uint64_t> m_reach[2];
+};
@@ -0,0 +1,62 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 15-12-2023
+ * @file Pacer.h
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+/**
+ * Paces the simulation steps against the real time
+ * In batch mode steps are not paced at all and the clock is never read.
+ * In paced mode every step ends at an absolute deadline computed from the start,
+ * so the time spent in the step itself does not accumulate into a drift.
+ */
+class Pacer {
+public:
+    enum class Mode {
+        Batch,
+        Paced
+    };
+
+    /**
+     * Create a pacer in batch mode
+     */
+    Pacer();
+
+    /**
+     * Create a pacer in paced mode
+     * @param steps_per_second simulation steps per second of real time
+     */
+    explicit Pacer(float steps_per_second);
+
+    /**
+     * Start measuring the deadlines from now
+     */
+    void start();
+
+    /**
+     * Wait until the deadline of the current step
+     * A step which is already past its deadline is counted as a missed frame
+     */
+    void step();
+
+    Mode mode() const;
+
+    /**
+     * Number of steps which finished after their deadline
+     */
+    uint64_t missed_frames() const;
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    Mode m_mode;
+    clock::duration m_period;
+    clock::time_point m_start;
+    uint64_t m_steps;
+    uint64_t m_missed;
+};
@@ -0,0 +1,67 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 17-12-2023
+ * @file ParameterSweep.h
+ */
+
+#pragma once
+
+#include "TrafficSimulator.h"
+#include "ThreadPool.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Runs the simulation over the Cartesian product of parameter values
+ * Every grid point is run for a number of replications, all runs are scheduled on a thread pool.
+ * Each worker keeps its own simulator and only reconfigures it between the runs.
+ */
+class ParameterSweep {
+public:
+    /**
+     * @param base parameters of the simulation which are not swept
+     */
+    explicit ParameterSweep(const SimulationParameters& base);
+
+    /**
+     * Add a swept parameter
+     * Accepted parameters are arrival-interval, two-lane-portion, max-speed and the names of the vehicle classes,
+     * cars, buses and trucks unless another table is loaded, which sweep the portions of the classes.
+     * Values are given either as an inclusive range first:last[:step] or as a list v1,v2,...
+     * @param spec parameter and its values, e.g. arrival-interval=1:10 or cars=800,900,1000
+     * @throws std::invalid_argument on malformed specification or a negative portion
+     */
+    void add(const std::string& spec);
+
+    /**
+     * Expand the grid
+     * @return parameters of all grid points, the last added parameter changes fastest
+     */
+    std::vector<SimulationParameters> points() const;
+
+    /**
+     * Run every grid point and write one table row per run
+     * @param seconds simulated seconds of each run
+     * @param replications runs of each grid point
+     * @param seed seed of the run, the n-th replication of every grid point uses the same random streams
+     * @param pool threads running the simulations
+     * @param output table with the averages of every run
+     */
+    void run(int seconds, uint32_t replications, uint64_t seed,
+             ThreadPool& pool, std::ostream& output) const;
+
+private:
+    struct Axis {
+        /**
+         * Swept parameter, nullptr for the portion of a vehicle class
+         */
+        int SimulationParameters::* parameter;
+        int vehicle_class;
+        std::vector<int> values;
+    };
+
+    SimulationParameters m_base;
+    std::vector<Axis> m_axes;
+};
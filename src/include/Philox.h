@@ -0,0 +1,152 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 18-12-2023
+ * @file Philox.h
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+/**
+ * Consumers of random numbers, every one of them gets its own stream
+ */
+enum class RandomStream : uint32_t {
+    Arrivals,
+    Slowdown,
+    Overtaking
+};
+
+/**
+ * Identifies the random streams of one replication
+ */
+struct StreamKey {
+    /**
+     * Seed of the whole run
+     */
+    uint64_t seed;
+    uint32_t replica;
+};
+
+/**
+ * Philox4x32-10 counter-based random generator
+ * (Salmon et al., Parallel random numbers: as easy as 1, 2, 3)
+ *
+ * The output is a bijection of a 128-bit counter under a 64-bit key.
+ * The key is the seed of the run, the upper half of the counter selects
+ * the replication and the consumer, so all streams are independent and reproducible.
+ * The lower half of the counter is either advanced sequentially (operator()),
+ * or addressed directly by the caller (draw()), in which case the result
+ * does not depend on the order in which the draws are made.
+ */
+class Philox {
+public:
+    using result_type = uint32_t;
+    using block_type = std::array<uint32_t, 4>;
+
+    Philox() : Philox({0, 0}, RandomStream::Arrivals) {
+    }
+
+    Philox(StreamKey key, RandomStream stream)
+        : m_key {static_cast<uint32_t>(key.seed), static_cast<uint32_t>(key.seed >> 32)},
+          m_replica(key.replica), m_stream(static_cast<uint32_t>(stream)), m_position(0), m_used(4) {
+    }
+
+    static constexpr result_type min() {
+        return 0;
+    }
+
+    static constexpr result_type max() {
+        return UINT32_MAX;
+    }
+
+    /**
+     * Next number of the sequential stream
+     */
+    result_type operator()() {
+        if (m_used == 4) {
+            m_block = block(static_cast<uint32_t>(m_position), static_cast<uint32_t>(m_position >> 32));
+            m_position++;
+            m_used = 0;
+        }
+        return m_block[m_used++];
+    }
+
+    /**
+     * Number addressed by the step and an index within the step
+     * @param step time step of the simulation
+     * @param index e.g. cell of the vehicle which draws the number
+     */
+    result_type draw(uint32_t step, uint32_t index) const {
+        return block(index, step)[0];
+    }
+
+    /**
+     * Numbers addressed like draw(), for a whole vector of indices at once
+     * Works on GCC vector types, U64 has to have the same number of lanes as U32
+     * @param numbers indices on input, in every lane the same number as draw() with the index on output
+     */
+    template <typename U32, typename U64>
+    __attribute__((always_inline)) // Part of SIMD kernels compiled for different instruction sets
+    void draw(uint32_t step, U32& numbers) const {
+        draw<U32, U64>(step, numbers, U32 {} + m_replica);
+    }
+
+    /**
+     * Numbers addressed like draw(), each lane from the stream of its own replication
+     * The replications share the seed and the consumer of this generator
+     * @param replicas replication of every lane
+     */
+    template <typename U32, typename U64>
+    __attribute__((always_inline))
+    void draw(uint32_t step, U32& numbers, const U32& replicas) const {
+        U32 counter_0 = numbers;
+        U32 counter_1 = U32 {} + step;
+        U32 counter_2 = replicas;
+        U32 counter_3 = U32 {} + m_stream;
+        uint32_t key[2] = {m_key[0], m_key[1]};
+        for (int round = 0; round < ROUNDS; ++round) {
+            U64 product_0 = __builtin_convertvector(counter_0, U64) * static_cast<uint64_t>(M0);
+            U64 product_1 = __builtin_convertvector(counter_2, U64) * static_cast<uint64_t>(M1);
+            counter_0 = __builtin_convertvector(product_1 >> 32, U32) ^ counter_1 ^ key[0];
+            counter_1 = __builtin_convertvector(product_1, U32);
+            counter_2 = __builtin_convertvector(product_0 >> 32, U32) ^ counter_3 ^ key[1];
+            counter_3 = __builtin_convertvector(product_0, U32);
+            key[0] += W0;
+            key[1] += W1;
+        }
+        numbers = counter_0;
+    }
+
+    /**
+     * Four numbers addressed by the lower half of the counter
+     */
+    block_type block(uint32_t counter_lo, uint32_t counter_hi) const {
+        block_type counter {counter_lo, counter_hi, m_replica, m_stream};
+        uint32_t key[2] = {m_key[0], m_key[1]};
+        for (int round = 0; round < ROUNDS; ++round) {
+            uint64_t product_0 = static_cast<uint64_t>(M0) * counter[0];
+            uint64_t product_1 = static_cast<uint64_t>(M1) * counter[2];
+            counter = {static_cast<uint32_t>(product_1 >> 32) ^ counter[1] ^ key[0], static_cast<uint32_t>(product_1),
+                       static_cast<uint32_t>(product_0 >> 32) ^ counter[3] ^ key[1], static_cast<uint32_t>(product_0)};
+            key[0] += W0;
+            key[1] += W1;
+        }
+        return counter;
+    }
+
+private:
+    static constexpr int ROUNDS = 10;
+    static constexpr uint32_t M0 = 0xD2511F53;
+    static constexpr uint32_t M1 = 0xCD9E8D57;
+    static constexpr uint32_t W0 = 0x9E3779B9;
+    static constexpr uint32_t W1 = 0xBB67AE85;
+
+    uint32_t m_key[2];
+    uint32_t m_replica;
+    uint32_t m_stream;
+    uint64_t m_position;
+    block_type m_block;
+    uint32_t m_used;
+};
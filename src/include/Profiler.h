@@ -0,0 +1,181 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 23-12-2023
+ * @file Profiler.h
+ */
+
+#pragma once
+
+#include "HardwareCounters.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+/**
+ * Parts of a road update measured by the profiler
+ */
+enum class ProfilePhase : uint8_t {
+    Slowdown,
+    Gap,
+    LaneChange,
+    Move,
+    Queue,
+    Stats,
+    Snapshot,
+    /**
+     * Everything outside the road update, e.g. arrivals, output and pacing
+     */
+    Other,
+    Count
+};
+
+/**
+ * Events counted by the profiler
+ */
+enum class ProfileCounter : uint8_t {
+    RngDraws,
+    GapProbes,
+    LaneChangeAttempts,
+    LaneChanges,
+    QueueInserts,
+    QueueRejections,
+    Count
+};
+
+/**
+ * Accumulates the time spent in every phase of the update and counts events
+ * The profiled thread is always in exactly one phase, entering a phase ends the previous one,
+ * so the sequential parts of the update are measured with a single clock read per switch.
+ * Every thread has its own profile, so the replications do not share counters.
+ * Optionally, hardware counters are read whenever the update moves to another stage
+ * (sweep over the vehicles, queue, stats, snapshot, other); the fine phases of the sweep
+ * alternate for every vehicle, a system call there would cost more than the phases themselves.
+ * The instrumentation in the engines is only compiled in with TRAFFIC_PROFILE defined,
+ * see the PROFILE_ macros below.
+ */
+class Profiler {
+public:
+    /**
+     * Time stamp counter on x86, nanoseconds of the steady clock elsewhere
+     */
+    static uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    static const char* tick_unit();
+
+    /**
+     * Read hardware counters in the profiles reset from now on
+     */
+    static void set_hardware_counters(bool enabled);
+
+    /**
+     * Profile of the calling thread
+     */
+    static Profiler& current() {
+        thread_local Profiler profiler;
+        return profiler;
+    }
+
+    /**
+     * End the current phase and start measuring the given one
+     */
+    void enter(ProfilePhase phase) {
+        uint64_t time = now();
+        m_ticks[static_cast<size_t>(m_phase)] += time - m_start;
+        m_phase = phase;
+        m_start = time;
+        m_calls[static_cast<size_t>(phase)]++;
+        if (m_hardware && stage_of(phase) != m_stage) {
+            enter_stage(stage_of(phase));
+        }
+    }
+
+    void count(ProfileCounter counter, uint64_t events = 1) {
+        m_counters[static_cast<size_t>(counter)] += events;
+    }
+
+    /**
+     * Clear the profile and start in the Other phase
+     */
+    void reset();
+
+    /**
+     * Print the table of the phases and the counters
+     * @param steps number of steps the profile was collected over
+     */
+    void report(std::ostream& output, uint64_t steps);
+
+private:
+    enum Stage {
+        Sweep,
+        QueueStage,
+        StatsStage,
+        SnapshotStage,
+        OtherStage,
+        STAGE_COUNT
+    };
+
+    static Stage stage_of(ProfilePhase phase) {
+        switch (phase) {
+            case ProfilePhase::Queue:
+                return QueueStage;
+            case ProfilePhase::Stats:
+                return StatsStage;
+            case ProfilePhase::Snapshot:
+                return SnapshotStage;
+            case ProfilePhase::Other:
+            case ProfilePhase::Count:
+                return OtherStage;
+            default:
+                return Sweep;
+        }
+    }
+
+    void enter_stage(Stage stage);
+
+    void report_hardware(std::ostream& output, uint64_t steps) const;
+
+    static std::atomic<bool> s_hardware_enabled;
+
+    std::array<uint64_t, static_cast<size_t>(ProfilePhase::Count)> m_ticks {};
+    std::array<uint64_t, static_cast<size_t>(ProfilePhase::Count)> m_calls {};
+    std::array<uint64_t, static_cast<size_t>(ProfileCounter::Count)> m_counters {};
+    ProfilePhase m_phase = ProfilePhase::Other;
+    uint64_t m_start = 0;
+
+    std::unique_ptr<HardwareCounters> m_hardware;
+    std::array<HardwareCounters::Values, STAGE_COUNT> m_stage_events {};
+    HardwareCounters::Values m_stage_start {};
+    Stage m_stage = OtherStage;
+};
+
+#ifdef TRAFFIC_PROFILE
+#define PROFILE_PHASE(phase) Profiler::current().enter(ProfilePhase::phase)
+#define PROFILE_COUNT(counter) Profiler::current().count(ProfileCounter::counter)
+/**
+ * Count the event inside a condition, always true
+ */
+#define PROFILE_COUNTED(counter) (Profiler::current().count(ProfileCounter::counter), true)
+#define PROFILE_RESET() Profiler::current().reset()
+#define PROFILE_REPORT(output, steps) Profiler::current().report(output, steps)
+#else
+#define PROFILE_PHASE(phase) ((void)0)
+#define PROFILE_COUNT(counter) ((void)0)
+#define PROFILE_COUNTED(counter) true
+#define PROFILE_RESET() ((void)0)
+#define PROFILE_REPORT(output, steps) ((void)0)
+#endif
@@ -0,0 +1,93 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 21-12-2023
+ * @file RingBuffer.h
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/**
+ * FIFO queue in a circular buffer
+ * The storage is allocated up front and reused; it is only reallocated
+ * when the queue outgrows it, so a queue which stays within its capacity never allocates.
+ */
+template <typename T>
+class RingBuffer {
+public:
+    /**
+     * @param capacity number of items stored without reallocation
+     * @param filler value of the unused slots, for types which are not default constructible
+     */
+    explicit RingBuffer(size_t capacity = 16, const T& filler = T()) : m_items(capacity > 0 ? capacity : 1, filler),
+                                                                       m_head(0), m_size(0) {
+    }
+
+    bool empty() const {
+        return m_size == 0;
+    }
+
+    bool full() const {
+        return m_size == m_items.size();
+    }
+
+    size_t size() const {
+        return m_size;
+    }
+
+    size_t capacity() const {
+        return m_items.size();
+    }
+
+    T& front() {
+        return m_items[m_head];
+    }
+
+    const T& front() const {
+        return m_items[m_head];
+    }
+
+    /**
+     * Append the item, doubling the storage if the queue is full
+     */
+    void push(T item) {
+        if (full()) {
+            grow();
+        }
+        m_items[(m_head + m_size) % m_items.size()] = std::move(item);
+        m_size++;
+    }
+
+    /**
+     * Remove the front item, the queue must not be empty
+     */
+    void pop() {
+        m_head = (m_head + 1) % m_items.size();
+        m_size--;
+    }
+
+    /**
+     * Remove all items, keeping the storage
+     */
+    void clear() {
+        m_head = 0;
+        m_size = 0;
+    }
+
+private:
+    void grow() {
+        std::vector<T> items(m_items.size() * 2, m_items[m_head]);
+        for (size_t i = 0; i < m_size; ++i) {
+            items[i] = std::move(m_items[(m_head + i) % m_items.size()]);
+        }
+        m_items = std::move(items);
+        m_head = 0;
+    }
+
+    std::vector<T> m_items;
+    size_t m_head;
+    size_t m_size;
+};
@@ -0,0 +1,63 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 30-12-2023
+ * @file RoadBatch.h
+ */
+
+#pragma once
+
+#include "RoadMap.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * A batch of replications of the same one lane road, updated together
+ * Each engine decides how the replications are laid out, the batch only sees them by their index.
+ */
+class RoadBatch {
+public:
+    /**
+     * @param replicas number of roads in the batch
+     */
+    RoadBatch(uint32_t road_len, uint32_t max_speed, uint32_t replicas);
+
+    virtual ~RoadBatch() = default;
+
+    /**
+     * Advance all roads by one step
+     * @param stats overwritten with one sample per road, their snapshot strings are reused
+     */
+    virtual void update(std::vector<TrafficDataSample>& stats) = 0;
+
+    /**
+     * Insert the vehicle into the road, or its queue if the entry is not free
+     * @param road index of the road within the batch
+     */
+    virtual void insert(uint32_t road, Vehicle vehicle) = 0;
+
+    /**
+     * Render the road into the string, like RoadMap
+     */
+    virtual void to_str(uint32_t road, std::string& road_string) const = 0;
+
+    /**
+     * @throws std::invalid_argument if the engine does not implement the rule
+     */
+    virtual void set_update_rule(UpdateRule rule);
+
+    uint32_t size() const;
+
+    uint32_t replicas() const;
+
+    void set_snapshots(bool enabled);
+
+protected:
+    bool m_snapshots;
+    UpdateRule m_update_rule;
+    uint32_t m_max_speed;
+    uint32_t m_min_speed;
+    uint32_t m_cell_count;
+    uint32_t m_replicas;
+    uint32_t m_step;
+};
@@ -0,0 +1,146 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 30-12-2023
+ * @file RoadBitSliced.h
+ */
+
+#pragma once
+
+#include "RoadBatch.h"
+
+#include <array>
+#include <string>
+#include <vector>
+
+/**
+ * Up to WIDTH replications of a one lane road with cars only, multi-spin coded
+ * Bit r of every word belongs to replication r: each cell holds a word of occupancy and
+ * SPEED_BITS words of speed bit planes, and the whole step is done by boolean operations
+ * on these words, so all replications of a cell are updated by the same few instructions.
+ *
+ * The engine runs the integer variant of the model: speeds are whole cells per second,
+ * a car accelerates or decelerates by one cell per second and the gaps are limited
+ * by the synchronous rule, so every cell depends only on the cells in front of it before the step.
+ * The slowdown decisions of a cell come from one stream for the whole batch,
+ * the replications are only reproducible in batches of the same layout.
+ */
+class RoadBitSliced : public RoadBatch {
+public:
+    /**
+     * Replications in one road, bits of a word
+     */
+    static constexpr uint32_t WIDTH = 64;
+
+    /**
+     * Bit planes of the speed, the maximal speed has to fit into them
+     */
+    static constexpr uint32_t SPEED_BITS = 3;
+
+    /**
+     * Always free cells behind the end of the road, the fastest cars leaving the road land in them
+     */
+    static constexpr uint32_t PADDING = (1u << SPEED_BITS) - 1;
+
+    /**
+     * @param seed seed of the run
+     * @param first_replica replication of the first road, it keys the slowdown stream of the batch
+     * @param replicas number of roads, 1 to WIDTH
+     * @throws std::invalid_argument if the number of roads or the maximal speed does not fit
+     */
+    RoadBitSliced(uint32_t road_len, uint32_t max_speed, uint64_t seed, uint32_t first_replica, uint32_t replicas);
+
+    void update(std::vector<TrafficDataSample>& stats) override;
+
+    /**
+     * @throws std::invalid_argument if the vehicle is not a car
+     */
+    void insert(uint32_t road, Vehicle vehicle) override;
+
+    void to_str(uint32_t road, std::string& road_string) const override;
+
+    /**
+     * @throws std::invalid_argument for the sequential rule, which needs the moved leader of every car
+     */
+    void set_update_rule(UpdateRule rule) override;
+
+    /**
+     * One cell of all replications
+     */
+    struct Cell {
+        uint64_t occupied;
+        std::array<uint64_t, SPEED_BITS> speed;
+    };
+
+    /**
+     * Vertical counters, one per replication, stored as bit planes of their values
+     */
+    struct Counters {
+        std::array<uint64_t, 32> planes;
+
+        void clear() {
+            planes.fill(0);
+        }
+
+        /**
+         * Add 2^shift to the counters of the replications set in the word
+         */
+        void add(uint64_t word, uint32_t shift) {
+            for (uint32_t plane = shift; word != 0 && plane < planes.size(); ++plane) {
+                uint64_t carry = planes[plane] & word;
+                planes[plane] ^= word;
+                word = carry;
+            }
+        }
+
+        uint32_t value(uint32_t road) const;
+    };
+
+private:
+    /**
+     * Advance the cars of all cells, sum up their new speeds and move them to m_next
+     */
+    template <uint32_t MAX_SPEED>
+    void sweep();
+
+    /**
+     * Cars of the cell which decelerate in the current step, each with the slowdown probability
+     * @param cars replications with a car in the cell
+     */
+    uint64_t slowdown_mask(uint32_t cell, uint64_t cars) const;
+
+    static bool occupied(const Cell& cell, uint32_t road) {
+        return (cell.occupied >> road) & 1;
+    }
+
+    static uint8_t speed(const Cell& cell, uint32_t road);
+
+    bool entry_free(uint32_t road) const;
+
+    void place_at_entry(uint32_t road, uint8_t speed);
+
+    /**
+     * Cells of the road followed by the padding
+     */
+    std::vector<Cell> m_cells;
+    /**
+     * Cells of the next step, swapped with m_cells after the sweep
+     */
+    std::vector<Cell> m_next;
+    /**
+     * Speeds of the queued cars of every road
+     */
+    std::vector<RingBuffer<uint8_t>> m_queues;
+    Philox m_slowdown_gen;
+    /**
+     * Slowdown probability as a fraction of 2^32
+     */
+    uint64_t m_slowdown_threshold;
+    /**
+     * Cars on every road
+     */
+    std::array<uint32_t, WIDTH> m_num_vehicles;
+    /**
+     * Speeds of the cars after the sweep, including the ones which left the road
+     */
+    Counters m_speed_sum;
+};
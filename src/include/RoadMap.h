@@ -9,40 +9,119 @@
 #include "traffic_simulation.h"
 #include "Vehicle.h"
 #include "TrafficData.h"
+#include "Lane.h"
+#include "Philox.h"
+#include "RingBuffer.h"
+#include "Profiler.h"
 
-#include <optional>
 #include <vector>
 #include <array>
-#include <queue>
+#include <memory>
 #include <string>
-#include <random>
 
-#define LEFT_LANE 1
-#define RIGHT_LANE 0
+constexpr uint8_t LEFT_LANE = 1;
+constexpr uint8_t RIGHT_LANE = 0;
+
+/**
+ * How the vehicles see each other during an update
+ */
+enum class UpdateRule {
+    /**
+     * The road is swept from its end, every vehicle sees the already moved vehicles in front of it
+     */
+    Sequential,
+    /**
+     * Every vehicle sees the road as it was before the step, the next step is written
+     * into a second buffer, so the vehicles can be updated independently
+     */
+    Synchronous
+};
 
 class Road {
 public:
 
-    static const int METERS_PER_CELL = M_PER_CELL;
-    static const int RAND_DEC_TH = RAND_DECELERATION_THRESHOLD;
-    static const int RAND_OVERTAKE_TH = RAND_OVERTAKE_THRESHOLD;
+    static constexpr int METERS_PER_CELL = 5;
+    /**
+     * Percent of the draws below or at which a vehicle slows down
+     */
+    static constexpr int RAND_DEC_TH = 5;
+    /**
+     * Percent of the draws below which a vehicle overtakes
+     */
+    static constexpr int RAND_OVERTAKE_TH = 80;
+    /**
+     * Vehicles waiting for the entry which fit into the queue without reallocation
+     */
+    static const size_t QUEUE_CAPACITY = 256;
+
+    /**
+     * Codes of the space-time recording, one byte per cell
+     * The front of a vehicle is coded as (type << 4) | speed, the speed saturates at 15 cells
+     */
+    static constexpr uint8_t CELL_EMPTY = 0xFF;
+    static constexpr uint8_t CELL_NO_LANE = 0xFE;
+    static constexpr uint8_t CELL_BODY = 0xFD;
+
+    static uint8_t cell_code(vt_t type, uint32_t speed) {
+        return static_cast<uint8_t>(type) << 4 | (speed < 15 ? speed : 15);
+    }
 
-    Road(uint32_t road_len, uint32_t max_speed);
+    /**
+     * @param key random streams of the road
+     */
+    Road(uint32_t road_len, uint32_t max_speed, StreamKey key);
 
     virtual
     ~Road() = default;
 
+    /**
+     * Advance the road by one step
+     * @param stats overwritten with the sample of the step, its snapshot strings are reused
+     */
     virtual
-    TrafficDataSample update() = 0;
+    void update(TrafficDataSample& stats) = 0;
 
     void insert(Vehicle vehicle);
 
+    std::string to_str() const;
+
+    /**
+     * Render the road into the string, reusing its storage
+     */
     virtual
-    std::string to_str() const = 0;
+    void to_str(std::string& road_string) const = 0;
 
     virtual
     uint32_t size() const = 0;
 
+    /**
+     * Encode every space_stride-th cell of the lane, starting with the first one, into the row
+     * @param row has to hold (size() + space_stride - 1) / space_stride bytes
+     */
+    virtual
+    void record(uint8_t lane, uint32_t space_stride, uint8_t* row) const;
+
+    /**
+     * Enable or disable rendering of the road into every sample
+     */
+    void set_snapshots(bool enabled);
+
+    /**
+     * Select how the vehicles see each other, the second buffer of the synchronous rule is allocated here
+     * @throws std::invalid_argument if the engine is built for a different rule
+     */
+    virtual
+    void set_update_rule(UpdateRule rule);
+
+    /**
+     * Remove all vehicles and start over with different parameters, keeping the allocated storage
+     * @param max_speed maximal speed in meters per second
+     * @param two_lane_portion portion of the road with two lanes, ignored by one lane roads
+     * @param key random streams of the road
+     */
+    virtual
+    void reset(uint32_t max_speed, uint8_t two_lane_portion, StreamKey key);
+
 protected:
 
     /**
@@ -53,59 +132,306 @@ protected:
     */
     int32_t insert_vehicle_from_queue();
 
-    bool lane_free_check(uint32_t position, uint8_t lane, uint8_t vehicle_length);
+    /**
+     * Cells the vehicle needs free at the beginning of the road
+     * Under the synchronous rule the vehicle also needs a free cell in front of it. It sees its leader
+     * where it was before the next step, right behind it the vehicle would stop and block the entry
+     * for the steps it takes to accelerate to a whole cell per second again.
+     */
+    uint8_t entry_length(const Vehicle& vehicle) const {
+        return vehicle.length() + (m_update_rule == UpdateRule::Synchronous ? 1 : 0);
+    }
+
+    /**
+     * Check whether a vehicle of the given length fits at the beginning of the road
+     */
+    virtual
+    bool entry_free(uint8_t vehicle_length);
+
+    /**
+     * Put the vehicle at the beginning of the road, its front at cell length() - 1
+     */
+    virtual
+    void place_at_entry(const Vehicle& vehicle);
+
+    /**
+     * Draw a number from 0 to 99 for a decision of the vehicle in the cell during the current step
+     * The number depends only on the step and the cell, not on the order of the draws
+     */
+    uint32_t draw_percent(const Philox& stream, uint8_t lane, uint32_t cell) const {
+        PROFILE_COUNT(RngDraws);
+        return stream.draw(m_step, cell * 2 + lane) % 100;
+    }
+
+    bool lane_free_check(uint32_t position, uint8_t lane, uint8_t vehicle_length) const;
 
-    std::string to_str(uint8_t lane) const;
+    /**
+     * Append the rendered lane to the string
+     * @param lane_start first cell of the lane, the cells before it are rendered as #
+     */
+    void lane_to_str(uint8_t lane, uint32_t lane_start, std::string& road_string) const;
+
+    void record(uint8_t lane, uint32_t lane_start, uint32_t space_stride, uint8_t* row) const;
+
+    /**
+     * Forget the leaders of the previous update sweep
+     * Has to be called before the sweep starts
+     */
+    void reset_leaders();
+
+    /**
+     * Place the vehicle into the road and record it in the leader index
+     * @param lane lane to place the vehicle into
+     * @param position cell of the vehicle's front
+     */
+    void place(uint8_t lane, uint32_t position, const Vehicle& vehicle);
 
-    std::string to_str(uint8_t lane, uint32_t lane_start) const;
+    /**
+     * Take the vehicle off the road
+     * A vehicle which switched lanes without moving is taken off again in the same sweep,
+     * in that case the leader index falls back to the next vehicle in the lane
+     * @param lane lane of the vehicle
+     * @param position cell of the vehicle's front
+     * @return the removed vehicle
+     */
+    Vehicle take(uint8_t lane, uint32_t position);
+
+    /**
+     * Limit the speed of the vehicle by the distance to its leader and move it
+     * @param leader position of the leader, int_max if there is none
+     * @return new position of the vehicle
+     */
+    static uint32_t drive(Vehicle& vehicle, uint32_t position, int32_t leader, uint8_t leader_length);
 
+    /**
+     * Insert a waiting vehicle, finish the sample and advance the step counter
+     * @param stats sample with the sum of the speeds and the flux of the sweep
+     * @param num_vehicles vehicles which stayed on the road
+     * @param num_occupied_spaces cells covered by the vehicles which stayed on the road
+     * @param left_lane_begin first cell of the left lane, ignored by one lane roads
+     */
+    void finish_update(TrafficDataSample& stats, uint32_t num_vehicles, uint32_t num_occupied_spaces, uint32_t left_lane_begin = 0);
+
+    bool m_snapshots;
+    UpdateRule m_update_rule;
     uint32_t m_max_speed;
     uint32_t m_min_speed;
     uint32_t m_cell_count;
-    std::vector<std::vector<std::optional<Vehicle>>> m_road;
-    std::queue<Vehicle> m_queue;
-    std::mt19937 m_gen;
+    std::vector<Lane> m_road;
+    RingBuffer<Vehicle> m_queue;
+    Philox m_slowdown_gen;
+    Philox m_overtake_gen;
+    /**
+     * Number of finished updates
+     */
+    uint32_t m_step;
+    /**
+     * Position of the nearest vehicle placed in each lane during the current sweep,
+     * int_max if there is none
+     */
+    std::vector<int32_t> m_leader;
+    /**
+     * Lanes the next step is written into, swapped with the road after the step
+     * Empty unless an engine needs them
+     */
+    std::vector<Lane> m_next;
+
+};
+
+/**
+ * Random slowdown of the one lane model
+ * A vehicle slows down with the probability RAND_DEC_TH %, unless it is slower than the minimal speed,
+ * otherwise it accelerates up to the maximal speed.
+ */
+struct RandomSlowdown {
+    /**
+     * @param draw returns the number from 0 to 99 of the vehicle, called only if the decision needs it
+     */
+    template <typename Draw>
+    static void apply(Vehicle& vehicle, uint8_t, uint32_t max_speed, uint32_t min_speed, Draw draw) {
+        if (draw() > Road::RAND_DEC_TH) {
+            if (vehicle.get_speed() < max_speed) {
+                vehicle.accelerate();
+            }
+        }
+        else if (vehicle.get_speed() >= min_speed) {
+            vehicle.decelerate();
+        }
+    }
+};
+
+/**
+ * Random slowdown of the two lane model
+ * Only the vehicles in the right lane faster than the minimal speed slow down, with the probability RAND_DEC_TH %.
+ */
+struct RightLaneSlowdown {
+    template <typename Draw>
+    static void apply(Vehicle& vehicle, uint8_t lane, uint32_t max_speed, uint32_t min_speed, Draw draw) {
+        if (lane == LEFT_LANE || vehicle.get_speed() <= min_speed || draw() > Road::RAND_DEC_TH) {
+            if (vehicle.get_speed() < max_speed) {
+                vehicle.accelerate();
+            }
+        }
+        else {
+            vehicle.decelerate();
+        }
+    }
+};
+
+/**
+ * Vehicles of all types
+ */
+struct MixedVehicles {
+    static constexpr bool CARS_ONLY = false;
+
+    static uint8_t length(const Vehicle& vehicle) {
+        return vehicle.length();
+    }
+
+    static uint8_t length(const Lane& lane, uint32_t cell) {
+        return lane.length(cell);
+    }
+};
+
+/**
+ * Cars only, every vehicle covers a single cell
+ */
+struct CarsOnly {
+    static constexpr bool CARS_ONLY = true;
+
+    static uint8_t length(const Vehicle&) {
+        return 1;
+    }
 
+    static uint8_t length(const Lane&, uint32_t) {
+        return 1;
+    }
 };
-class RoadMap : public Road{
+
+/**
+ * Road stored as cells, specialised at compile time for one configuration
+ * The lane count, the update rule, the vehicle types and the slowdown rule are template parameters,
+ * so the update of the chosen configuration has no branches on them and every helper is inlined into it.
+ * Instances are created by make_cells_road() from the configurations it knows.
+ * @tparam LANES 1 or 2, with two lanes the left one starts after the one lane portion of the road
+ * @tparam RULE update rule, fixed for the lifetime of the road
+ * @tparam Vehicles MixedVehicles or CarsOnly
+ * @tparam Slowdown RandomSlowdown or RightLaneSlowdown
+ */
+template <uint8_t LANES, UpdateRule RULE, class Vehicles, class Slowdown>
+class RoadCells : public Road {
 public:
+    static_assert(LANES == 1 || LANES == 2, "The road has one or two lanes");
+
     /**
-     *
-     * @param cells
-     * @param max_speed
+     * @param two_lane_portion portion of the road with two lanes in integer percentage, ignored by one lane roads
      */
-    RoadMap(uint32_t road_len, uint32_t max_speed);
+    RoadCells(uint32_t road_len, uint32_t max_speed, uint8_t two_lane_portion, StreamKey key);
+
+    void update(TrafficDataSample& stats) override;
 
-    TrafficDataSample update() override;
+    void reset(uint32_t max_speed, uint8_t two_lane_portion, StreamKey key) override;
 
-    std::string to_str() const override;
+    using Road::to_str;
+
+    void to_str(std::string& road_string) const override;
 
     uint32_t size() const override;
 
+    void record(uint8_t lane, uint32_t space_stride, uint8_t* row) const override;
+
+    /**
+     * @throws std::invalid_argument if the rule is not RULE
+     */
+    void set_update_rule(UpdateRule rule) override;
+
 protected:
 
+    bool entry_free(uint8_t vehicle_length) override;
+
+    /**
+     * @throws std::invalid_argument if the road takes cars only and the vehicle is not a car
+     */
+    void place_at_entry(const Vehicle& vehicle) override;
+
+    void update_sequential(TrafficDataSample& stats);
+
+    /**
+     * With two lanes the update runs in two sub-steps, both deciding on the road before the sub-step:
+     * the vehicles change lanes without moving forward, then they move forward in their lanes
+     */
+    void update_synchronous(TrafficDataSample& stats);
+
     /**
-     * Get distance to the next vehicle
+     * Move the vehicles of the lane forward, keeping the distances to their leaders in the lane
+     * @tparam SLOWDOWN slow down the vehicles first, in the same pass
+     * @param from lane before the move
+     * @param to empty lane the vehicles are moved into
+     */
+    template <bool SLOWDOWN>
+    void advance(const Lane& from, uint8_t lane, Lane& to, TrafficDataSample& stats, uint32_t& num_vehicles, uint32_t& num_occupied_spaces);
+
+    /**
+     * Front most vehicle front of all lanes at the cell or behind it, -1 if there is none
+     */
+    int32_t prev_occupied(int32_t from) const;
+
+    /**
+     * Get distance to the nearest vehicle placed during the current sweep
+     * Since the road is swept from its end, every vehicle in front of the
+     * swept position has already been placed, so this is the leader
      * x_lead - x - L_veh
      * @param from x
-     * @return distance to the vehicle in front, int_max if there are no cars in front
+     * @return distance to the vehicle in front, int_max if there are no cars in front,
+     * zero if the left lane has not started yet
      */
-    int32_t get_driving_distance(int32_t from);
-};
+    int32_t driving_distance(uint32_t from, uint8_t lane) const;
 
-class RoadMapTwoLane : public Road {
-public:
-    RoadMapTwoLane(uint32_t road_len, uint32_t max_speed, uint8_t two_lane_portion);
+    /**
+     * Get distance to the vehicle in front in the lane, as the lane is now
+     * x_lead - x - L_veh
+     * @return distance to the vehicle in front, int_max if there are no cars in front,
+     * zero if the left lane has not started yet
+     */
+    int32_t lane_gap(const Lane& lane, uint32_t from, uint8_t lane_index) const;
 
-    TrafficDataSample update() override;
+    /**
+     * Check whether the vehicle overtakes from the right lane, the leaders are given by the gap function
+     */
+    template <typename Gap>
+    bool overtakes(const Vehicle& vehicle, uint32_t cell, Gap gap) const;
 
-    std::string to_str() const override;
+    bool lane_free(uint32_t position, uint8_t lane, uint8_t vehicle_length) const;
 
-    uint32_t size() const override;
+    void slow_down(Vehicle& vehicle, uint8_t lane, uint32_t cell) const {
+        Slowdown::apply(vehicle, lane, m_max_speed, m_min_speed, [&] { return draw_percent(m_slowdown_gen, lane, cell); });
+    }
 
-protected:
+    uint32_t m_left_lane_begin;
+};
 
-    int32_t get_driving_distance(uint32_t from, uint8_t lane);
+/**
+ * Configuration of the cells engine, the key of its dispatch table
+ */
+struct CellsConfig {
+    uint8_t lanes;
+    UpdateRule rule;
+    bool cars_only;
 
-    uint32_t m_left_lane_begin;
+    bool operator==(const CellsConfig& other) const {
+        return lanes == other.lanes && rule == other.rule && cars_only == other.cars_only;
+    }
 };
+
+/**
+ * Create the cells engine specialised for the configuration
+ * The one lane roads use RandomSlowdown, the two lane ones RightLaneSlowdown.
+ * @throws std::invalid_argument if the configuration has no specialisation
+ */
+std::unique_ptr<Road> make_cells_road(const CellsConfig& config, uint32_t road_len, uint32_t max_speed, uint8_t two_lane_portion, StreamKey key);
+
+/**
+ * Default one lane and two lane roads
+ */
+using RoadMap = RoadCells<1, UpdateRule::Sequential, MixedVehicles, RandomSlowdown>;
+using RoadMapTwoLane = RoadCells<2, UpdateRule::Sequential, MixedVehicles, RightLaneSlowdown>;
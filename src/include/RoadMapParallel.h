@@ -0,0 +1,96 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 27-12-2023
+ * @file RoadMapParallel.h
+ */
+
+#pragma once
+
+#include "RoadMap.h"
+#include "ThreadPool.h"
+
+#include <vector>
+
+/**
+ * One lane road updated by several threads, each owning contiguous chunks of the lane
+ * Produces the same results as RoadMap.
+ *
+ * Every step runs in three phases:
+ *  1. in parallel, every chunk slows down its vehicles and moves all of them,
+ *     except the ones at its front whose move may depend on the vehicle in the next chunk
+ *  2. serially, from the end of the road, the vehicles left out in phase 1 are moved
+ *  3. in parallel, every chunk writes the vehicles which ended up in its cells into the next lane
+ * The vehicles of phase 2 are the ones following too closely to reach their speed whatever
+ * the leader does, so the serial phase is short unless a jam spans the chunk boundary.
+ * Chunks are aligned to bitmap words, so the writes of different threads never share a word.
+ * With the synchronous rule no vehicle depends on the next chunk and the serial phase is empty.
+ */
+class RoadMapParallel : public Road {
+public:
+    /**
+     * @param threads number of worker threads, hardware concurrency if 0
+     */
+    RoadMapParallel(uint32_t road_len, uint32_t max_speed, StreamKey key, uint32_t threads = 0);
+
+    void update(TrafficDataSample& stats) override;
+
+    void reset(uint32_t max_speed, uint8_t two_lane_portion, StreamKey key) override;
+
+    using Road::to_str;
+
+    void to_str(std::string& road_string) const override;
+
+    uint32_t size() const override;
+
+protected:
+    /**
+     * Chunks per worker thread, the spare chunks even out the load by work stealing
+     */
+    static const uint32_t CHUNKS_PER_THREAD = 4;
+    /**
+     * Smaller chunks do not pay for the synchronization
+     */
+    static const uint32_t MIN_CHUNK_CELLS = 256;
+
+    struct Chunk {
+        uint32_t begin;
+        uint32_t end;
+        /**
+         * Vehicles of the chunk from its end to its beginning with their positions before and after the step
+         */
+        std::vector<Vehicle> vehicles;
+        std::vector<uint32_t> position;
+        std::vector<uint32_t> new_position;
+        /**
+         * Number of vehicles at the front of the chunk which are moved by the serial phase
+         */
+        uint32_t coupled;
+        uint32_t num_vehicles;
+        uint32_t num_occupied_spaces;
+        uint32_t flux;
+        float speed_sum;
+    };
+
+    /**
+     * Split the lane into chunks, each longer than the maximal speed
+     */
+    void split();
+
+    /**
+     * Phase 1, move the vehicles of the chunk which do not depend on the next chunk
+     */
+    void sweep(Chunk& chunk);
+
+    /**
+     * Phase 2, move the vehicles left out by sweep() from the end of the road
+     */
+    void resolve_boundaries();
+
+    /**
+     * Phase 3, write the vehicles which ended up in the cells of the chunk into the next lane
+     */
+    void write(uint32_t chunk_index);
+
+    std::vector<Chunk> m_chunks;
+    ThreadPool m_pool;
+};
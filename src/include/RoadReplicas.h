@@ -0,0 +1,136 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 29-12-2023
+ * @file RoadReplicas.h
+ */
+
+#pragma once
+
+#include "RoadBatch.h"
+#include "SimdLevel.h"
+
+#include <array>
+#include <string>
+#include <vector>
+
+/**
+ * Up to WIDTH replications of the same one lane road, updated together by SIMD kernels
+ * The cells are stored interleaved, cell-major and replica-minor, so the same cell of all
+ * replications fits into one vector. The roads are swept from their end cell by cell and every
+ * vector lane keeps the leader of its own replication, so the control flow is the same for all of them.
+ *
+ * Every replication draws from its own random streams with the same keys as RoadMap,
+ * so each of them follows exactly the course of a RoadMap with its key, with both update rules.
+ */
+class RoadReplicas : public RoadBatch {
+public:
+    /**
+     * Replications in one road, lanes of the widest kernel
+     */
+    static constexpr uint32_t WIDTH = 16;
+
+    /**
+     * @param seed seed of the run
+     * @param first_replica replication of the first road, the others follow it
+     * @param replicas number of roads, 1 to WIDTH
+     * @throws std::invalid_argument if the number of roads does not fit
+     */
+    RoadReplicas(uint32_t road_len, uint32_t max_speed, uint64_t seed, uint32_t first_replica, uint32_t replicas);
+
+    void update(std::vector<TrafficDataSample>& stats) override;
+
+    void insert(uint32_t road, Vehicle vehicle) override;
+
+    void to_str(uint32_t road, std::string& road_string) const override;
+
+    /**
+     * Byte per vehicle class plus one for the empty cells
+     */
+    using Table = SimdLanes<16>::u8;
+
+    static_assert(VehicleClasses::MAX_CLASSES < sizeof(Table), "The class codes have to index a table");
+
+    /**
+     * Interleaved cells and parameters of one update, passed to the kernels
+     */
+    struct Sweep {
+        /**
+         * Class of the vehicle with its front in the cell plus one, 0 if there is none
+         */
+        uint8_t* vehicle_class;
+        /**
+         * Exact speed of the vehicle with its front in the cell
+         */
+        speed_t* speed;
+        uint32_t cells;
+        uint32_t roads;
+        int32_t max_speed;
+        int32_t min_speed;
+        /**
+         * Parameters of the vehicles indexed like vehicle_class, the empty cells have a zero length
+         * The acceleration and deceleration are below a cell per second, only their fractions are stored.
+         */
+        Table length;
+        Table acceleration;
+        Table deceleration;
+        bool synchronous;
+        /**
+         * Slowdown stream of every road, a vector of draws takes the key of the first one
+         * and the replications of the lanes
+         */
+        const Philox* slowdown_gen;
+        uint32_t step;
+        const uint32_t* replica;
+        /**
+         * Statistics of every road
+         */
+        uint32_t num_vehicles[WIDTH];
+        uint32_t num_occupied_spaces[WIDTH];
+        uint32_t speed_sum[WIDTH];
+        uint32_t flux[WIDTH];
+    };
+
+private:
+    size_t index(uint32_t cell, uint32_t road) const {
+        return static_cast<size_t>(cell) * WIDTH + road;
+    }
+
+    /**
+     * Length of the vehicle with its front in the cell, 0 if there is none
+     */
+    uint8_t length(uint32_t cell, uint32_t road) const {
+        uint8_t vehicle_class = m_class[index(cell, road)];
+        return vehicle_class ? VehicleClasses::table().length[vehicle_class - 1] : 0;
+    }
+
+    /**
+     * Same conditions as Road::lane_free_check for every cell of the new vehicle
+     */
+    bool entry_free(uint32_t road, uint8_t vehicle_length) const;
+
+    /**
+     * Same as Road::entry_length
+     */
+    uint8_t entry_length(const Vehicle& vehicle) const {
+        return vehicle.length() + (m_update_rule == UpdateRule::Synchronous ? 1 : 0);
+    }
+
+    void place_at_entry(uint32_t road, const Vehicle& vehicle);
+
+    /**
+     * Same as Road::insert_vehicle_from_queue, including the cell 0 reported for an empty queue
+     */
+    int32_t insert_vehicle_from_queue(uint32_t road);
+
+    std::array<uint32_t, WIDTH> m_replica;
+    /**
+     * Class of the vehicle with its front in the cell plus one, 0 if there is none
+     */
+    std::vector<uint8_t> m_class;
+    std::vector<speed_t> m_speed;
+    std::vector<RingBuffer<Vehicle>> m_queues;
+    /**
+     * Slowdown stream of every road
+     */
+    std::vector<Philox> m_slowdown_gens;
+};
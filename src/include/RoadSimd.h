@@ -0,0 +1,90 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 28-12-2023
+ * @file RoadSimd.h
+ */
+
+#pragma once
+
+#include "RoadMap.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * One lane road with cars only, updated by SIMD kernels
+ * The cars are kept as arrays of positions and speeds ordered from the front of the road,
+ * like in RoadVehicleList, and a kernel updates 4, 8 or 16 of them per instruction.
+ * The kernel follows the SIMD level picked at runtime (AVX-512, AVX2 or the portable one).
+ *
+ * The random draws stay keyed by the step and the cell and the speeds follow the fixed point arithmetic
+ * of Vehicle, so the results are the same as of the other one lane engines with both update rules.
+ * The gap limit of the sequential rule is a running minimum over the vehicles,
+ * which is computed as a prefix minimum within the vector.
+ */
+class RoadSimd : public Road {
+public:
+    RoadSimd(uint32_t road_len, uint32_t max_speed, StreamKey key);
+
+    void update(TrafficDataSample& stats) override;
+
+    using Road::to_str;
+
+    void to_str(std::string& road_string) const override;
+
+    uint32_t size() const override;
+
+    void record(uint8_t lane, uint32_t space_stride, uint8_t* row) const override;
+
+    void reset(uint32_t max_speed, uint8_t two_lane_portion, StreamKey key) override;
+
+    /**
+     * Arrays and parameters of one update, passed to the kernels
+     */
+    struct Sweep {
+        /**
+         * Cell of each car, descending, overwritten with the new cell
+         */
+        int32_t* position;
+        /**
+         * Exact speed of each car, overwritten with the new speed
+         */
+        speed_t* speed;
+        uint32_t count;
+        uint32_t cells;
+        int32_t max_speed;
+        int32_t min_speed;
+        int32_t acceleration;
+        int32_t deceleration;
+        bool synchronous;
+        const Philox* slowdown_gen;
+        uint32_t step;
+        /**
+         * Number of cars which left the road, they are at the beginning of the arrays
+         */
+        uint32_t left;
+        uint32_t speed_sum;
+    };
+
+protected:
+    bool entry_free(uint8_t vehicle_length) override;
+
+    /**
+     * @throws std::invalid_argument if the vehicle is not a car
+     */
+    void place_at_entry(const Vehicle& vehicle) override;
+
+    /**
+     * Drop the cars which left the road from the beginning of the arrays
+     */
+    void compact();
+
+    /**
+     * Index of the front most car still on the road
+     */
+    uint32_t m_first;
+    std::vector<int32_t> m_position;
+    std::vector<speed_t> m_speed;
+    speed_t m_acceleration;
+    speed_t m_deceleration;
+};
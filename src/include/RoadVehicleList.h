@@ -0,0 +1,55 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 14-12-2023
+ * @file RoadVehicleList.h
+ */
+
+#pragma once
+
+#include "RoadMap.h"
+
+#include <vector>
+
+/**
+ * One lane road which keeps only the list of vehicles instead of all cells
+ * Vehicles are ordered from the front of the road to its beginning,
+ * so the cost of an update scales with the number of vehicles, not with the road length.
+ * Produces the same results as RoadMap.
+ */
+class RoadVehicleList : public Road {
+public:
+    RoadVehicleList(uint32_t road_len, uint32_t max_speed, StreamKey key);
+
+    void update(TrafficDataSample& stats) override;
+
+    using Road::to_str;
+
+    void to_str(std::string& road_string) const override;
+
+    uint32_t size() const override;
+
+    void record(uint8_t lane, uint32_t space_stride, uint8_t* row) const override;
+
+    void reset(uint32_t max_speed, uint8_t two_lane_portion, StreamKey key) override;
+
+protected:
+
+    bool entry_free(uint8_t vehicle_length) override;
+
+    void place_at_entry(const Vehicle& vehicle) override;
+
+    /**
+     * Drop the vehicles which left the road from the beginning of the arrays
+     */
+    void compact();
+
+    /**
+     * Index of the front most vehicle still on the road
+     */
+    uint32_t m_first;
+    /**
+     * Cell of the front of each vehicle, descending
+     */
+    std::vector<uint32_t> m_position;
+    std::vector<Vehicle> m_vehicles;
+};
@@ -0,0 +1,53 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 29-12-2023
+ * @file SimdLevel.h
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Instruction sets the SIMD engines have kernels for
+ */
+enum class SimdLevel {
+    Avx512,
+    Avx2,
+    Portable
+};
+
+/**
+ * GCC vector types with W lanes, the kernels are written with them for every level
+ * A kernel template has to be explicitly instantiated under #pragma GCC target of its level,
+ * together with the templates it calls. Inlining it into a function with a target attribute is not enough,
+ * its vector operations would already be split for the default instruction set.
+ */
+template <int W>
+struct SimdLanes {
+    typedef uint8_t u8 __attribute__((vector_size(W)));
+    typedef uint16_t u16 __attribute__((vector_size(2 * W)));
+    typedef int32_t i32 __attribute__((vector_size(4 * W)));
+    typedef uint32_t u32 __attribute__((vector_size(4 * W)));
+    typedef uint64_t u64 __attribute__((vector_size(8 * W)));
+};
+
+const char* simd_level_name(SimdLevel level);
+
+/**
+ * Levels supported by the CPU, from the widest one
+ */
+std::vector<SimdLevel> supported_simd_levels();
+
+/**
+ * Level of the kernels used by all SIMD engines, the widest supported one unless selected
+ */
+SimdLevel simd_level();
+
+/**
+ * Use the kernels of the given level instead of the widest ones, e.g. to compare them
+ * @return false if the level is unknown or not supported by the CPU
+ */
+bool select_simd_level(const std::string& name);
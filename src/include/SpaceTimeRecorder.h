@@ -0,0 +1,67 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 20-12-2023
+ * @file SpaceTimeRecorder.h
+ */
+
+#pragma once
+
+#include "RoadMap.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * Records the road as a space-time matrix with one byte per cell
+ * The matrix is streamed into a uint8 .npy file of shape (steps, lanes, cells),
+ * lane 0 being the right lane. Only every time_stride-th step and every
+ * space_stride-th cell is kept. The cell codes are described by Road::cell_code,
+ * a json file with the same stem records them together with the strides.
+ */
+class SpaceTimeRecorder {
+public:
+    /**
+     * Size of the buffer written to the file at once
+     */
+    static const size_t BLOCK_SIZE = 1 << 20;
+
+    /**
+     * @param path .npy file to create
+     * @param lanes number of lanes of the road
+     * @param cells number of cells of the road
+     * @throw std::runtime_error if the file cannot be created
+     * @throw std::invalid_argument if a stride or the number of cells is 0
+     */
+    SpaceTimeRecorder(const std::filesystem::path& path, uint8_t lanes, uint32_t cells,
+                      uint32_t time_stride = 1, uint32_t space_stride = 1);
+
+    /**
+     * Record the road after an update
+     * @throw std::runtime_error if writing the file failed
+     */
+    void record(const Road& road);
+
+    /**
+     * Write the rest of the matrix, fill in its shape and write the description
+     * @throw std::runtime_error if writing a file failed
+     */
+    void finish();
+
+private:
+    /**
+     * @throw std::runtime_error if writing the file failed
+     */
+    static void check(const std::ofstream& file, const std::filesystem::path& path);
+
+    std::filesystem::path m_path;
+    std::ofstream m_file;
+    uint8_t m_lanes;
+    uint32_t m_columns;
+    uint32_t m_time_stride;
+    uint32_t m_space_stride;
+    uint64_t m_steps;
+    uint64_t m_rows;
+    std::vector<uint8_t> m_block;
+};
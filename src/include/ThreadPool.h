@@ -0,0 +1,90 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 16-12-2023
+ * @file ThreadPool.h
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of worker threads executing submitted tasks
+ * Every worker owns a queue of tasks, submitted tasks are dealt to the queues round robin.
+ * A worker takes tasks from the back of its own queue and when it runs out of them,
+ * it steals from the front of the other queues, so short and long tasks even out.
+ */
+class ThreadPool {
+public:
+    /**
+     * Worker index of threads which do not belong to any pool
+     */
+    static const uint32_t NOT_A_WORKER = UINT32_MAX;
+
+    /**
+     * @param threads number of worker threads, hardware concurrency if 0
+     */
+    explicit ThreadPool(uint32_t threads = 0);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+
+    /**
+     * Block until all submitted tasks are finished
+     */
+    void wait();
+
+    uint32_t size() const;
+
+    /**
+     * Get index of the worker executing the calling task
+     * @return index in 0..size()-1, NOT_A_WORKER when not called from a task
+     */
+    static uint32_t current_worker();
+
+private:
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void worker(uint32_t index);
+
+    /**
+     * Take a task from the own queue or steal one from the others
+     */
+    bool take_task(uint32_t index, std::function<void()>& task);
+
+    std::vector<std::thread> m_workers;
+    std::vector<std::unique_ptr<TaskQueue>> m_queues;
+    std::atomic<uint32_t> m_next_queue;
+
+    /**
+     * Guards sleeping of the workers and waiting for the tasks to finish
+     */
+    std::mutex m_mutex;
+    std::condition_variable m_task_ready;
+    std::condition_variable m_all_done;
+    /**
+     * Submitted tasks which have not been finished yet
+     */
+    uint32_t m_pending;
+    /**
+     * Submitted tasks which have not been taken by a worker yet
+     */
+    uint32_t m_queued;
+    bool m_stop;
+};
@@ -0,0 +1,119 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 26-12-2023
+ * @file Tracer.h
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <ostream>
+#include <string>
+
+/**
+ * Records a timeline of spans (steps, updates, output writes, thread pool tasks)
+ * and writes it as Chrome trace-event json, readable by chrome://tracing and Perfetto
+ *
+ * Every thread appends to its own buffer without any locking, the buffers are
+ * merged only when the trace is written after all threads have finished.
+ * When the tracer is disabled, a span costs a single relaxed atomic load.
+ */
+class Tracer {
+public:
+    /**
+     * Start recording
+     * @param step_interval record every n-th simulation step only, to keep the overhead low
+     */
+    static void enable(uint32_t step_interval);
+
+    static bool enabled() {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Whether the given simulation step is recorded
+     */
+    static bool sampled(uint64_t step) {
+        return enabled() && step % s_step_interval == 0;
+    }
+
+    /**
+     * Nanoseconds of the steady clock
+     */
+    static uint64_t now();
+
+    /**
+     * Record a finished span on the calling thread
+     * @param name static string, it is not copied
+     * @param category static string, it is not copied
+     * @param arg value shown with the span, e.g. the step or the replica, ignored if negative
+     */
+    static void record(const char* name, const char* category, uint64_t begin, uint64_t end, int64_t arg = -1);
+
+    /**
+     * Name the calling thread in the timeline
+     */
+    static void set_thread_name(const std::string& name);
+
+    /**
+     * Write all recorded spans, no thread may be recording at the time
+     */
+    static void write(std::ostream& output);
+
+private:
+    static std::atomic<bool> s_enabled;
+    static uint32_t s_step_interval;
+};
+
+/**
+ * Records the span from its construction to its destruction
+ */
+class TraceSpan {
+public:
+    /**
+     * @param active record the span, e.g. only for sampled steps
+     */
+    TraceSpan(const char* name, const char* category, bool active = true, int64_t arg = -1)
+            : m_name(name), m_category(category), m_arg(arg), m_begin(active && Tracer::enabled() ? Tracer::now() : 0) {
+    }
+
+    ~TraceSpan() {
+        if (m_begin != 0) {
+            Tracer::record(m_name, m_category, m_begin, Tracer::now(), m_arg);
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* m_name;
+    const char* m_category;
+    int64_t m_arg;
+    uint64_t m_begin;
+};
+
+/**
+ * Enables the tracer for its lifetime and writes the trace when destroyed,
+ * so it has to outlive every thread pool and writer which records spans
+ */
+class TraceSession {
+public:
+    /**
+     * @throws std::runtime_error if the trace file cannot be opened
+     */
+    TraceSession(const std::filesystem::path& path, uint32_t step_interval);
+
+    ~TraceSession();
+
+    TraceSession(const TraceSession&) = delete;
+
+    TraceSession& operator=(const TraceSession&) = delete;
+
+private:
+    std::ofstream m_file;
+};
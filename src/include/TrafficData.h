@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <vector>
 #include <string>
 
@@ -16,19 +17,76 @@ struct TrafficDataSample {
     std::vector<std::string> road_snapshot;
 };
 
-class TrafficData {
+/**
+ * Receives the samples of a simulation as they are produced
+ */
+class TrafficDataSink {
 public:
-    TrafficData();
+    virtual
+    ~TrafficDataSink() = default;
+
+    /**
+     * Called before the first sample of the simulation
+     * @param steps number of samples which will follow
+     */
+    virtual
+    void begin(uint32_t) {}
+
+    virtual
+    void add_sample(const TrafficDataSample& sample) = 0;
 
+    /**
+     * Called after the last sample of the simulation
+     */
     virtual
-    ~TrafficData() = default;
+    void finish() {}
+
+    /**
+     * Whether the samples have to carry road snapshots
+     */
+    virtual
+    bool wants_snapshots() const = 0;
+
+    /**
+     * Header of the csv output
+     * @param lanes number of lanes of the road
+     * @param snapshots whether the rows contain road snapshots
+     */
+    static std::string csv_header(uint8_t lanes, bool snapshots);
+
+    /**
+     * Append one row of the csv output
+     * @param road_snapshot rendered lanes, right lane first, empty if the row contains no snapshots
+     */
+    static void append_csv_row(std::string& csv, float avg_speed, float density, float flux,
+                               const std::vector<std::string>& road_snapshot);
+};
+
+/**
+ * Keeps all samples of the simulation in memory
+ */
+class TrafficData : public TrafficDataSink {
+public:
+    /**
+     * @param snapshots whether the samples carry road snapshots to be stored
+     */
+    explicit TrafficData(bool snapshots = true);
 
     virtual
     std::string to_csv() const = 0;
 
-    void add_sample(const TrafficDataSample& sample);
+    /**
+     * Reserve the storage of all samples, so no allocations are made while they arrive
+     */
+    void begin(uint32_t steps) override;
+
+    void add_sample(const TrafficDataSample& sample) override;
+
+    bool wants_snapshots() const override;
 
 protected:
+    bool m_snapshots;
+
     /**
      * Average speed of all vehicles on the road
      */
@@ -51,10 +109,14 @@ protected:
 
 class OneLaneTrafficData : public TrafficData {
 public:
+    using TrafficData::TrafficData;
+
     std::string to_csv() const override;
 };
 
 class TwoLaneTrafficData : public TrafficData {
 public:
+    using TrafficData::TrafficData;
+
     std::string to_csv() const override;
 };
\ No newline at end of file
@@ -0,0 +1,143 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 19-12-2023
+ * @file TrafficDataSinks.h
+ */
+
+#pragma once
+
+#include "TrafficData.h"
+#include "BackgroundWriter.h"
+#include "Philox.h"
+
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+
+struct SimulationParameters;
+
+/**
+ * Format of the stored samples
+ */
+enum class OutputFormat {
+    Csv,
+    Npy
+};
+
+/**
+ * Streams the samples as csv rows through a background writer
+ * Rows are collected into chunks of CHUNK_SIZE bytes, only one chunk is kept in memory.
+ */
+class CsvSink : public TrafficDataSink {
+public:
+    static const size_t CHUNK_SIZE = 1 << 16;
+
+    /**
+     * @param writer output of the rows, may be shared by several sinks
+     * @param lanes number of lanes of the road
+     * @param snapshots whether the rows contain road snapshots
+     * @param header write the csv header before the first row
+     * @param replica value of the leading replica column, no such column if empty
+     */
+    CsvSink(std::shared_ptr<BackgroundWriter> writer, uint8_t lanes, bool snapshots, bool header = true,
+            std::optional<uint32_t> replica = std::nullopt);
+
+    void add_sample(const TrafficDataSample& sample) override;
+
+    void finish() override;
+
+    bool wants_snapshots() const override;
+
+private:
+    std::shared_ptr<BackgroundWriter> m_writer;
+    bool m_snapshots;
+    std::string m_prefix;
+    std::string m_chunk;
+};
+
+/**
+ * Keeps only the running averages of the samples
+ */
+class SummarySink : public TrafficDataSink {
+public:
+    SummarySink();
+
+    void add_sample(const TrafficDataSample& sample) override;
+
+    bool wants_snapshots() const override;
+
+    float avg_speed() const;
+
+    float density() const;
+
+    float flux() const;
+
+private:
+    uint64_t m_samples;
+    double m_avg_speed;
+    double m_density;
+    double m_flux;
+};
+
+/**
+ * Stores the samples as binary columns in a directory
+ * Every column (avg_speed, density, flux) is a numpy .npy file of little-endian float32 values,
+ * so it can be memory mapped without any parsing. meta.json next to them records
+ * the schema, the parameters of the simulation and the seed.
+ * Road snapshots are not stored.
+ */
+class NpySink : public TrafficDataSink {
+public:
+    /**
+     * Samples buffered per column before they are written
+     */
+    static const size_t BLOCK_SAMPLES = 1 << 14;
+
+    /**
+     * @param directory created if it does not exist
+     * @param parameters parameters of the simulation recorded in the metadata
+     * @param key seed and replication recorded in the metadata
+     * @throw std::runtime_error if the files cannot be created
+     */
+    NpySink(const std::filesystem::path& directory, const SimulationParameters& parameters, StreamKey key);
+
+    void add_sample(const TrafficDataSample& sample) override;
+
+    /**
+     * Write the rest of the columns, fill in their lengths and write the metadata
+     * @throw std::runtime_error if writing a file failed
+     */
+    void finish() override;
+
+    bool wants_snapshots() const override;
+
+    static const size_t NPY_HEADER_SIZE = 128;
+
+    /**
+     * Header of a .npy file, always NPY_HEADER_SIZE bytes long, so it can be rewritten once the shape is known
+     * @param descr numpy type of the elements, e.g. <f4
+     * @param shape python tuple, e.g. (10, 2)
+     */
+    static std::string npy_header(const std::string& descr, const std::string& shape);
+
+private:
+    static const size_t COLUMNS = 3;
+    static const std::array<const char*, COLUMNS> COLUMN_NAMES;
+
+    void flush_block();
+
+    /**
+     * @throw std::runtime_error if writing the file of the run directory failed
+     */
+    void check(const std::ofstream& file, const std::string& name) const;
+
+    std::filesystem::path m_directory;
+    std::string m_parameters;
+    StreamKey m_key;
+    uint64_t m_samples;
+    std::array<std::ofstream, COLUMNS> m_files;
+    std::array<std::vector<float>, COLUMNS> m_block;
+};
@@ -7,38 +7,197 @@
 #pragma once
 
 #include <memory>
+#include <optional>
+#include <random>
 #include "traffic_simulation.h"
 #include "RoadMap.h"
 #include "Vehicle.h"
 #include "TrafficData.h"
+#include "Pacer.h"
+#include "SpaceTimeRecorder.h"
+#include "RoadBatch.h"
+#include "AliasTable.h"
 
 enum class SimType {
     OneLane,
     TwoLane
 };
 
+enum class RoadEngine {
+    Cells,
+    VehicleList,
+    Parallel,
+    Simd,
+    /**
+     * Replications run in batches by ReplicaSimulator, a single one is the same as the cells engine
+     */
+    Replicas,
+    /**
+     * Integer speed cars in batches of 64 replications by ReplicaSimulator, synchronous rule only
+     */
+    BitSliced
+};
+
+/**
+ * Name of the engine as given on the command line
+ */
+const char* engine_name(RoadEngine engine);
+
+/**
+ * Name of the update rule as given on the command line
+ */
+const char* update_rule_name(UpdateRule rule);
+
+/**
+ * Parameters of a simulation run
+ */
+struct SimulationParameters {
+    /**
+     * Portions of the vehicle classes among the arrivals, indexed by the class
+     * The types are drawn in proportion to them, only cars arrive if they are all zero.
+     * The defaults are the ones of the vehicle class table, which has to be loaded before.
+     */
+    std::vector<int> portions = VehicleClasses::table().portions();
+    /**
+     * Mean time between vehicle arrivals (seconds)
+     */
+    int arrival_interval = ARRIVAL_INTERVAL;
+    int max_speed_ms = MAX_SPEED_MS;
+    int road_length_m = ROAD_LENGTH_M;
+    SimType type = SimType::OneLane;
+    /**
+     * Portion of the road with two lanes in integer percentage
+     */
+    int left_lane_portion = LEFT_LANE_PORTION;
+    RoadEngine engine = RoadEngine::Cells;
+    UpdateRule update_rule = UpdateRule::Sequential;
+    /**
+     * Worker threads of the parallel engine, all cores if 0
+     */
+    uint32_t engine_threads = 0;
+};
+
+/**
+ * Arrivals of the vehicles at the beginning of the road
+ * The times, types and initial speeds are drawn from the generator in the order of the arrivals
+ */
+class ArrivalProcess {
+public:
+    /**
+     * @param gen arrivals stream of the replication, has to outlive the process
+     */
+    ArrivalProcess(const SimulationParameters& parameters, Philox& gen);
+
+    /**
+     * Vehicle arriving in the step, the steps have to be asked for one after another
+     */
+    std::optional<Vehicle> arrival(int step);
+
+    /**
+     * Whether only the first class, the cars, can arrive
+     */
+    static bool cars_only(const SimulationParameters& parameters);
+
+private:
+    Philox& m_gen;
+    std::exponential_distribution<> m_gen_next_arrival_time;
+    std::uniform_int_distribution<int> m_gen_init_speed;
+    AliasTable m_vehicle_types;
+    int m_next_arrival;
+    vt_t m_vehicle_type;
+};
+
 class TrafficSimulator {
 public:
-    TrafficSimulator(
-            int car_portion,
-            int bus_portion,
-            int truck_portion,
-            int arrival_interval,
-            int max_speed_ms,
-            int road_length_m,
-            SimType type,
-            int left_lane_portion
-            );
-
-    std::shared_ptr<TrafficData> simulate(int seconds, float speed_up_ratio);
+    /**
+     * @param parameters parameters of the simulation
+     * @param key random streams of the replication
+     */
+    TrafficSimulator(const SimulationParameters& parameters, StreamKey key);
+
+    /**
+     * Run the simulation
+     * @param seconds number of simulated seconds (steps)
+     * @param pacer paces the steps against the real time
+     * @param sink receives the sample of every step as soon as it is computed
+     */
+    void simulate(int seconds, Pacer& pacer, TrafficDataSink& sink);
 
     void reset();
 
+    /**
+     * Start over with an empty road and different parameters, keeping the allocated storage
+     * unless the cells engine needs another specialisation for them
+     * The road length, the simulation type and the engine have to stay the same
+     * @param parameters new parameters of the simulation
+     * @param key new random streams
+     */
+    void reconfigure(const SimulationParameters& parameters, StreamKey key);
+
+    /**
+     * Set how often the road is rendered to the standard output
+     * @param steps_per_frame render every n-th step, 0 disables rendering
+     */
+    void set_render_interval(int steps_per_frame);
+
+    /**
+     * Record the road of every step of the following simulations
+     * @param recorder finished at the end of the simulation, nullptr disables the recording
+     */
+    void set_recorder(SpaceTimeRecorder* recorder);
+
 private:
-    int m_car_portion, m_bus_portion, m_truck_portion;
-    int m_max_speed;
-    int m_arrival_interval;
+    /**
+     * Create the road of the engine for the parameters
+     */
+    void make_road();
+
+    SimulationParameters m_parameters;
+    int m_render_interval;
     std::unique_ptr<Road> m_road;
-    std::mt19937 m_gen;
-    std::shared_ptr<TrafficData> m_stats;
+    StreamKey m_key;
+    Philox m_gen;
+    SpaceTimeRecorder* m_recorder;
+    /**
+     * Sample of the current step, reused so its snapshot strings keep their storage
+     */
+    TrafficDataSample m_sample;
+};
+
+/**
+ * Runs a batch of replications of the same scenario together in one RoadBatch of the engine
+ * Every replication gets the same arrivals as from a TrafficSimulator with its key, with the replicas engine
+ * also the same samples. The steps are run unpaced and without rendering.
+ */
+class ReplicaSimulator {
+public:
+    /**
+     * @param parameters parameters of all replications, the simulation has to be one lane
+     * with the replicas or bitsliced engine
+     * @param seed seed of the run
+     * @param first_replica replication of the first road of the batch
+     * @param replicas number of replications, 1 to width() of the engine
+     */
+    ReplicaSimulator(const SimulationParameters& parameters, uint64_t seed, uint32_t first_replica, uint32_t replicas);
+
+    /**
+     * Most replications in one batch of the engine
+     */
+    static uint32_t width(RoadEngine engine);
+
+    /**
+     * Run the simulation
+     * @param seconds number of simulated seconds (steps)
+     * @param sinks one sink per replication of the batch
+     */
+    void simulate(int seconds, const std::vector<TrafficDataSink*>& sinks);
+
+private:
+    SimulationParameters m_parameters;
+    std::unique_ptr<RoadBatch> m_road;
+    /**
+     * Arrivals stream of every replication
+     */
+    std::vector<Philox> m_gens;
+    std::vector<TrafficDataSample> m_samples;
 };
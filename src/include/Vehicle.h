@@ -6,46 +6,115 @@
 
 #pragma once
 
+#include "VehicleClasses.h"
+
 #include <cstdint>
 #include <string>
 
-enum class vt_t {
-    car,
-    bus,
-    truck
-};
-
-
+/**
+ * A vehicle is its speed and its class, the parameters of the class are looked up in VehicleClasses
+ */
 class Vehicle {
 public:
-    float Acceleration;
+    /**
+     * Fractional bits of the fixed point speed
+     */
+    static constexpr int SPEED_FRACTION_BITS = 8;
+
+    static constexpr speed_t SPEED_FRACTION_MASK = (1 << SPEED_FRACTION_BITS) - 1;
+
+    explicit Vehicle(vt_t vehicle_type, uint8_t initial_speed = 1)
+                     : m_current_speed(static_cast<speed_t>(initial_speed << SPEED_FRACTION_BITS)), m_type(vehicle_type) {
+    }
+
+    /**
+     * Rebuild a vehicle from its packed representation
+     * @param vehicle_type type of the vehicle
+     * @param speed exact fixed point speed including the fractional part
+     */
+    static Vehicle restore(vt_t vehicle_type, speed_t speed) {
+        Vehicle vehicle(vehicle_type);
+        vehicle.m_current_speed = speed;
+        return vehicle;
+    }
+
+    /**
+     * Fixed point speed nearest to the speed in cells per second
+     */
+    static constexpr speed_t fixed_speed(float cells_per_second) {
+        return static_cast<speed_t>(cells_per_second * (1 << SPEED_FRACTION_BITS) + 0.5f);
+    }
 
-    float Deceleration;
+    /**
+     * Get length of the vehicle type in cells
+     */
+    static uint8_t length_of(vt_t vehicle_type) {
+        return VehicleClasses::table().length[static_cast<uint8_t>(vehicle_type)];
+    }
 
-    uint8_t Length;
+    uint8_t length() const {
+        return length_of(m_type);
+    }
 
-    explicit Vehicle(vt_t vehicle_type, uint8_t initial_speed = 1);
+    /**
+     * Get acceleration of the vehicle per step
+     */
+    speed_t acceleration() const {
+        return VehicleClasses::table().acceleration[static_cast<uint8_t>(m_type)];
+    }
 
-    virtual
-    ~Vehicle() = default;
+    /**
+     * Get deceleration of the vehicle per step
+     */
+    speed_t deceleration() const {
+        return VehicleClasses::table().deceleration[static_cast<uint8_t>(m_type)];
+    }
 
     /**
      * Get speed of vehicle in cells per second
-     * @return speed of the vehicle rounded to integer
+     * @return speed of the vehicle rounded down to integer
      */
-    uint8_t get_speed() const;
+    uint8_t get_speed() const {
+        return m_current_speed >> SPEED_FRACTION_BITS;
+    }
 
-    void set_speed(uint8_t speed);
+    /**
+     * Replace the whole cells of the speed, the fractional part is kept
+     */
+    void set_speed(uint8_t speed) {
+        m_current_speed = (m_current_speed & SPEED_FRACTION_MASK) | static_cast<speed_t>(speed << SPEED_FRACTION_BITS);
+    }
+
+    /**
+     * Get exact fixed point speed of vehicle including the fractional part
+     */
+    speed_t get_raw_speed() const {
+        return m_current_speed;
+    }
 
-    vt_t get_vehicle_type() const;
+    vt_t get_vehicle_type() const {
+        return m_type;
+    }
 
-    void accelerate();
+    void accelerate() {
+        m_current_speed += acceleration();
+    }
 
-    void decelerate();
+    void decelerate() {
+        speed_t deceleration = this->deceleration();
+        if (m_current_speed > deceleration) {
+            m_current_speed -= deceleration;
+        }
+    }
 
     std::string to_str() const;
 
+    /**
+     * Append the same text as to_str(), without a temporary string
+     */
+    void append_str(std::string& out) const;
+
 protected:
-    float m_current_speed;
+    speed_t m_current_speed;
     vt_t m_type;
 };
@@ -0,0 +1,120 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 31-12-2023
+ * @file VehicleClasses.h
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Index of a vehicle class in VehicleClasses
+ * The built-in classes are named, a loaded table may define further ones after them.
+ */
+enum class vt_t : uint8_t {
+    car,
+    bus,
+    truck
+};
+
+/**
+ * Speed in cells per second as Q8.8 fixed point, the upper byte holds the whole cells
+ */
+using speed_t = uint16_t;
+
+/**
+ * Parameters of the vehicle classes, one contiguous array per parameter indexed by the class
+ * The vehicles carry only their class, so adding a parameter does not make them larger.
+ * There is a single table for the whole process, it is either the built-in one or loaded
+ * once at startup, before any road or simulator exists.
+ */
+class VehicleClasses {
+public:
+    /**
+     * The class takes the upper 4 bits of a space-time code, its last value would collide with the reserved codes
+     */
+    static constexpr uint8_t MAX_CLASSES = 15;
+
+    /**
+     * The engines look at most two cells behind the front of a vehicle
+     */
+    static constexpr uint8_t MAX_LENGTH = 3;
+
+    /**
+     * Acceleration per step, fixed point like the speed and below a whole cell per second
+     */
+    std::array<speed_t, MAX_CLASSES> acceleration {};
+
+    /**
+     * Deceleration per step, fixed point like the speed and below a whole cell per second
+     */
+    std::array<speed_t, MAX_CLASSES> deceleration {};
+
+    /**
+     * Length in cells
+     */
+    std::array<uint8_t, MAX_CLASSES> length {};
+
+    /**
+     * Character rendered after the speed in the other cells of the vehicle
+     */
+    std::array<char, MAX_CLASSES> symbol {};
+
+    /**
+     * Default portions of the classes among the arriving vehicles
+     */
+    std::array<int, MAX_CLASSES> portion {};
+
+    /**
+     * Names of the portions of the classes, as swept and written to the output
+     */
+    std::vector<std::string> names;
+
+    /**
+     * Cars, buses and trucks, as described in data/data_desc.md
+     */
+    static VehicleClasses builtin();
+
+    /**
+     * Replace the table of the process by the classes of a csv file
+     * The file has the header name,symbol,length,acceleration,deceleration,portion and one class per line,
+     * the acceleration and deceleration are in cells per second squared. The first class has to be one cell long,
+     * the engines simulating only cars take it as the car.
+     * @throws std::runtime_error if the file cannot be read
+     * @throws std::invalid_argument if the table is malformed
+     */
+    static void load(const std::string& path);
+
+    static const VehicleClasses& table() {
+        return s_table;
+    }
+
+    uint8_t size() const {
+        return static_cast<uint8_t>(names.size());
+    }
+
+    /**
+     * Default portions of all classes
+     */
+    std::vector<int> portions() const {
+        return std::vector<int>(portion.begin(), portion.begin() + size());
+    }
+
+    /**
+     * @return class with the portion name, -1 if there is none
+     */
+    int find(const std::string& name) const;
+
+private:
+    /**
+     * @throws std::invalid_argument if the class does not fit the engines
+     */
+    void add(const std::string& name, char class_symbol, int class_length, float class_acceleration,
+             float class_deceleration, int class_portion);
+
+    static VehicleClasses s_table;
+};
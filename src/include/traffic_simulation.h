@@ -10,14 +10,12 @@
 #define ARRIVAL_INTERVAL 3
 
 #define ROAD_LENGTH_M 1200
-#define M_PER_CELL 5
 #define MAX_SPEED_MS 25
 
-#define RAND_DECELERATION_THRESHOLD 5
-#define RAND_OVERTAKE_THRESHOLD 80
-
 #define LEFT_LANE_PORTION 50
 
+#define RENDER_FPS 10
+
 #define CAR_PORTION_RATIO 829
 #define BUS_PORTION_RATIO 4
 #define TRUCK_PORTION_RATIO 167
@@ -7,12 +7,52 @@
 
 #include "include/traffic_simulation.h"
 #include "include/TrafficSimulator.h"
-#include "include/TrafficData.h"
+#include "include/TrafficDataSinks.h"
+#include "include/BackgroundWriter.h"
+
+#include "include/ThreadPool.h"
+#include "include/ParameterSweep.h"
+#include "include/Profiler.h"
+#include "include/Tracer.h"
+#include "include/RoadSimd.h"
+#include "include/RoadBitSliced.h"
+#include "include/SimdLevel.h"
 
 #include "include/args.h"
 
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
 #include <memory>
+#include <random>
+#include <vector>
+
+namespace {
 
+/**
+ * Close the combined writer and report a failed write of any output
+ * @param combined writer of the combined output, may be null
+ * @param failed whether a replication failed
+ * @return exit code of the process
+ */
+int finish_output(std::shared_ptr<BackgroundWriter> combined, bool failed) {
+    try {
+        if (combined) {
+            combined->close();
+        }
+    }
+    catch (std::runtime_error&) {
+        // Reported with the writers of the replications below
+    }
+    if (BackgroundWriter::failed()) {
+        std::cerr << "Writing the output failed, it is incomplete" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+}
 
 int main(int argc, char* argv[]) {
     args::ArgumentParser parser("Traffic simulation using cellular automata");
@@ -27,8 +67,39 @@ int main(int argc, char* argv[]) {
     args::ValueFlag<int> max_speed(simulation_types, "Max speed (m/s)", "Maximal speed in meters per second", {"max-speed"}, MAX_SPEED_MS, args::Options::Global);
     args::ValueFlag<int> road_length(simulation_types, "Road length (m)", "The length of the road section to be simulated, in meters", {'l', "road_length"}, ROAD_LENGTH_M, args::Options::Global);
     args::ValueFlag<float > time(simulation_types, "Simulation time (h)", "The length of the simulation in hours", {'t', "time"}, 1, args::Options::Global);
+    args::MapFlag<std::string, RoadEngine> road_engine(simulation_types, "Road engine", "Update engine: cells (default), vehicle-list, parallel, simd, replicas or bitsliced (one-lane only, simd with cars only, "
+                                                                    "replicas runs up to 16 replications at once, bitsliced up to 64 with integer speed cars and the synchronous rule)", {"engine"},
+            {{"cells", RoadEngine::Cells}, {"vehicle-list", RoadEngine::VehicleList}, {"parallel", RoadEngine::Parallel}, {"simd", RoadEngine::Simd},
+             {"replicas", RoadEngine::Replicas}, {"bitsliced", RoadEngine::BitSliced}},
+            RoadEngine::Cells, args::Options::Global);
+    args::ValueFlag<std::string> simd_kernel(simulation_types, "SIMD kernel", "Kernels of the simd and replicas engines: avx512, avx2 or portable, the widest supported ones if not given", {"simd-kernel"}, args::Options::Global);
+    args::MapFlag<std::string, UpdateRule> update_rule(simulation_types, "Update rule", "sequential (default), every vehicle sees the already moved vehicles in front of it, "
+                                                                     "or synchronous, every vehicle sees the road before the step", {"update-rule"},
+            {{"sequential", UpdateRule::Sequential}, {"synchronous", UpdateRule::Synchronous}}, UpdateRule::Sequential, args::Options::Global);
     args::ValueFlag<float> sim_speed_up(simulation_types, "Simulation speed up", "", {"speed-up"}, 1, args::Options::Global);
-    args::Group vehicle_distribution(simulation_types, "Specify the portions of specific vehicle types. All vehicle portions have to sum up to a 1000", args::Group::Validators::AllOrNone, args::Options::Global);
+    args::Flag batch(simulation_types, "Batch", "Run as fast as possible without pacing the steps against the real time", {"batch"}, args::Options::Global);
+    args::Flag headless(simulation_types, "Headless", "Do not render the road to the standard output", {"headless"}, args::Options::Global);
+    args::ValueFlag<float> render_fps(simulation_types, "Frame rate", "Rendered frames per second of real time", {"fps"}, RENDER_FPS, args::Options::Global);
+    args::Flag no_snapshots(simulation_types, "No snapshots", "Do not store road snapshots in the output data", {"no-snapshots"}, args::Options::Global);
+    args::ValueFlag<uint32_t> replications(simulation_types, "Replications", "Number of independent replications run in parallel", {"replications"}, 1, args::Options::Global);
+    args::ValueFlag<uint32_t> threads(simulation_types, "Threads", "Number of threads running the replications or the parallel engine, all cores if 0", {"threads"}, 0, args::Options::Global);
+    args::ValueFlag<std::string> output_dir(simulation_types, "Output directory", "Write the data of replication n to <dir>/<n>.csv (<dir>/<n>/ for npy) instead of the standard error output", {"output-dir"}, "", args::Options::Global);
+    args::MapFlag<std::string, OutputFormat> output_format(simulation_types, "Output format", "Format of the data: csv (default) or npy, binary float32 columns which need --output-dir", {"format"},
+            {{"csv", OutputFormat::Csv}, {"npy", OutputFormat::Npy}}, OutputFormat::Csv, args::Options::Global);
+    args::ValueFlag<std::string> space_time(simulation_types, "Space-time file", "Record the road with one byte per cell into a .npy matrix instead of storing road snapshots, "
+                                                                     "replication n is written to <stem>_<n>.npy", {"space-time"}, args::Options::Global);
+    args::ValueFlag<uint32_t> time_stride(simulation_types, "Time stride", "Record every n-th step into the space-time matrix", {"time-stride"}, 1, args::Options::Global);
+    args::ValueFlag<uint32_t> space_stride(simulation_types, "Space stride", "Record every n-th cell into the space-time matrix", {"space-stride"}, 1, args::Options::Global);
+    args::Flag hw_counters(simulation_types, "Hardware counters", "Add hardware performance counters to the profile of a profiling build (make PROFILE=1)", {"hw-counters"}, args::Options::Global);
+    args::ValueFlag<std::string> trace(simulation_types, "Trace file", "Write a timeline of the steps, output writes and thread pool tasks as Chrome trace json (chrome://tracing, Perfetto)", {"trace"}, args::Options::Global);
+    args::ValueFlag<uint32_t> trace_every(simulation_types, "Trace interval", "Trace every n-th simulation step", {"trace-every"}, 10, args::Options::Global);
+    args::ValueFlag<uint64_t> seed_flag(simulation_types, "Seed", "Seed of the random streams, random if not given", {"seed"}, args::Options::Global);
+    args::ValueFlagList<std::string> sweep(simulation_types, "Sweep", "Run over a grid of parameter values, given as parameter=first:last[:step] or parameter=v1,v2,... "
+                                                          "for arrival-interval, two-lane-portion, max-speed and the vehicle classes, cars, buses and trucks by default", {"sweep"}, {}, args::Options::Global);
+    args::ValueFlag<std::string> vehicle_classes(simulation_types, "Vehicle classes", "Load the vehicle classes from a csv file with the header name,symbol,length,acceleration,deceleration,portion "
+                                                                          "instead of the built-in cars, buses and trucks, see data/vehicle_classes.csv", {"vehicle-classes"}, args::Options::Global);
+    args::Group vehicle_distribution(simulation_types, "Specify the portions of the first three vehicle classes, the vehicle types arrive in proportion to them. "
+                                                       "By convention all vehicle portions sum up to a 1000", args::Group::Validators::AllOrNone, args::Options::Global);
         args::ValueFlag<int> car_portion(vehicle_distribution, "Portion of the cars", "", {"cars"}, CAR_PORTION_RATIO, args::Options::Global);
         args::ValueFlag<int> bus_portion(vehicle_distribution, "Portion of the buses", "", {"buses"}, BUS_PORTION_RATIO, args::Options::Global);
         args::ValueFlag<int> truck_portion(vehicle_distribution, "Portion of the trucks", "", {"trucks"}, TRUCK_PORTION_RATIO, args::Options::Global);
@@ -51,6 +122,30 @@ int main(int argc, char* argv[]) {
         return EXIT_FAILURE;
     }
 
+    if (vehicle_classes) {
+        try {
+            VehicleClasses::load(args::get(vehicle_classes));
+        }
+        catch (std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    std::vector<int> portions = VehicleClasses::table().portions();
+    if (car_portion) {
+        if (portions.size() < 3) {
+            std::cerr << "The vehicle classes have no buses and trucks, give the portions in the table" << std::endl;
+            return EXIT_FAILURE;
+        }
+        portions[0] = args::get(car_portion);
+        portions[1] = args::get(bus_portion);
+        portions[2] = args::get(truck_portion);
+    }
+    if (std::any_of(portions.begin(), portions.end(), [](int portion) { return portion < 0; })) {
+        std::cerr << "The vehicle portions cannot be negative" << std::endl;
+        return EXIT_FAILURE;
+    }
+
     SimType simulation_type;
     if (one_lane_simulator) {
         simulation_type = SimType::OneLane;
@@ -58,19 +153,292 @@ int main(int argc, char* argv[]) {
     else if (two_lane_simulator) {
         simulation_type = SimType::TwoLane;
     }
+    if (simulation_type == SimType::TwoLane && args::get(road_engine) != RoadEngine::Cells) {
+        std::cerr << "The selected engine supports only the one-lane simulation" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (args::get(road_engine) == RoadEngine::Simd || args::get(road_engine) == RoadEngine::BitSliced) {
+        bool swept_vehicles = std::any_of(args::get(sweep).begin(), args::get(sweep).end(), [](const std::string& spec) {
+            return VehicleClasses::table().find(spec.substr(0, spec.find('='))) >= 0;
+        });
+        bool other_vehicles = std::any_of(portions.begin() + 1, portions.end(), [](int portion) { return portion != 0; });
+        if (other_vehicles || swept_vehicles) {
+            std::cerr << "The " << engine_name(args::get(road_engine)) << " engine simulates only cars, use --cars 1000 --buses 0 --trucks 0 "
+                      << "or give only the first vehicle class a portion" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (args::get(road_engine) == RoadEngine::BitSliced) {
+        if (args::get(update_rule) != UpdateRule::Synchronous) {
+            std::cerr << "The bitsliced engine implements only the synchronous rule, use --update-rule synchronous" << std::endl;
+            return EXIT_FAILURE;
+        }
+        uint32_t max_cells = (1u << RoadBitSliced::SPEED_BITS) - 1;
+        if (args::get(max_speed) < Road::METERS_PER_CELL || args::get(max_speed) / Road::METERS_PER_CELL > static_cast<int>(max_cells)) {
+            std::cerr << "The bitsliced engine needs a maximal speed of " << Road::METERS_PER_CELL << " to "
+                      << max_cells * Road::METERS_PER_CELL + Road::METERS_PER_CELL - 1 << " m/s" << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (sweep || space_time) {
+            std::cerr << "The bitsliced engine runs neither parameter sweeps nor the space-time recording" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (simd_kernel && !select_simd_level(args::get(simd_kernel))) {
+        std::cerr << "The SIMD kernel " << args::get(simd_kernel) << " is unknown or not supported by the CPU" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (args::get(road_engine) == RoadEngine::Parallel && (args::get(replications) > 1 || sweep)) {
+        std::cerr << "The parallel engine runs a single replication, the replications are run in parallel already" << std::endl;
+        return EXIT_FAILURE;
+    }
 
-    auto simulator = std::make_unique<TrafficSimulator>(
-            args::get(car_portion), // Car portion
-            args::get(bus_portion), // Bus portion
-            args::get(truck_portion), // Truck portion
-            args::get(arrival_interval), // Arrival interval (seconds)
-            args::get(max_speed), // Max speed (m/s)
-            args::get(road_length), // Road length (m)
-            simulation_type,
-            args::get(two_lane_portion)
-            );
+    if (args::get(output_format) == OutputFormat::Npy && sweep) {
+        std::cerr << "Parameter sweeps write a single csv table, the npy format is not available for them" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (args::get(output_format) == OutputFormat::Npy && args::get(output_dir).empty()) {
+        std::cerr << "The npy format needs an output directory" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (space_time && args::get(road_engine) == RoadEngine::Replicas && args::get(replications) > 1) {
+        std::cerr << "The space-time recording is not available for replications run by the replicas engine" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (space_time && sweep) {
+        std::cerr << "The space-time recording is not available for parameter sweeps" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (space_time && args::get(road_length) < Road::METERS_PER_CELL) {
+        std::cerr << "The space-time recording needs a road of at least one cell, " << Road::METERS_PER_CELL << " m" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (args::get(time_stride) == 0 || args::get(space_stride) == 0) {
+        std::cerr << "The strides of the space-time recording have to be positive" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (hw_counters) {
+#ifdef TRAFFIC_PROFILE
+        Profiler::set_hardware_counters(true);
+#else
+        std::cerr << "Hardware counters are only read by a profiling build (make PROFILE=1)" << std::endl;
+#endif
+    }
+
+    if (args::get(replications) == 0) {
+        std::cerr << "At least one replication has to be run" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Declared before the pools and writers, the trace is written after their threads have finished
+    std::unique_ptr<TraceSession> trace_session;
+    if (trace) {
+        try {
+            trace_session = std::make_unique<TraceSession>(args::get(trace), args::get(trace_every));
+        }
+        catch (std::runtime_error& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Every replication and every consumer within it get their own stream keyed by the seed
+    uint64_t seed = 0;
+    if (seed_flag) {
+        seed = args::get(seed_flag);
+    }
+    else {
+        std::random_device rd;
+        seed = static_cast<uint64_t>(rd()) << 32 | rd();
+        std::cout << "Seed: " << seed << std::endl; // Allows to reproduce the run
+    }
+    SimulationParameters parameters;
+    parameters.portions = portions;
+    parameters.arrival_interval = args::get(arrival_interval);
+    parameters.max_speed_ms = args::get(max_speed);
+    parameters.road_length_m = args::get(road_length);
+    parameters.type = simulation_type;
+    parameters.left_lane_portion = args::get(two_lane_portion);
+    parameters.engine = args::get(road_engine);
+    parameters.engine_threads = args::get(threads);
+    parameters.update_rule = args::get(update_rule);
+    auto make_simulator = [&](uint32_t replica) {
+        return std::make_unique<TrafficSimulator>(parameters, StreamKey {seed, replica});
+    };
+    uint8_t lanes = simulation_type == SimType::TwoLane ? 2 : 1;
+    // The space-time matrix replaces the road snapshots
+    bool snapshots = !no_snapshots && !space_time;
+    // Samples are written while the simulation runs, the writer thread keeps the disk off the hot loop
+    auto open_writer = [&](uint32_t replica) {
+        return std::make_shared<BackgroundWriter>(std::filesystem::path(args::get(output_dir)) / (std::to_string(replica + 1) + ".csv"));
+    };
+    uint32_t cells = parameters.road_length_m / Road::METERS_PER_CELL;
+    auto make_recorder = [&](uint32_t replica) -> std::unique_ptr<SpaceTimeRecorder> {
+        if (!space_time) {
+            return nullptr;
+        }
+        std::filesystem::path path = args::get(space_time);
+        if (args::get(replications) > 1) {
+            path.replace_filename(path.stem().string() + "_" + std::to_string(replica + 1) + ".npy");
+        }
+        return std::make_unique<SpaceTimeRecorder>(path, lanes, cells, args::get(time_stride), args::get(space_stride));
+    };
+    auto make_file_sink = [&](uint32_t replica) -> std::unique_ptr<TrafficDataSink> {
+        if (args::get(output_format) == OutputFormat::Npy) {
+            return std::make_unique<NpySink>(std::filesystem::path(args::get(output_dir)) / std::to_string(replica + 1),
+                                             parameters, StreamKey {seed, replica});
+        }
+        return std::make_unique<CsvSink>(open_writer(replica), lanes, snapshots);
+    };
+    int seconds = static_cast<int>(args::get(time) * HOUR_SEC);
+
+    if (sweep) {
+        ParameterSweep parameter_sweep(parameters);
+        try {
+            for (const auto& spec : args::get(sweep)) {
+                parameter_sweep.add(spec);
+            }
+        }
+        catch (std::invalid_argument& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        ThreadPool pool(args::get(threads));
+        bool written;
+        if (args::get(output_dir).empty()) {
+            parameter_sweep.run(seconds, args::get(replications), seed, pool, std::cerr);
+            written = static_cast<bool>(std::cerr.flush());
+        }
+        else {
+            std::filesystem::create_directories(args::get(output_dir));
+            std::ofstream file(std::filesystem::path(args::get(output_dir)) / "sweep.csv");
+            parameter_sweep.run(seconds, args::get(replications), seed, pool, file);
+            written = static_cast<bool>(file.flush());
+        }
+        if (!written) {
+            std::cerr << "Writing the sweep failed, it is incomplete" << std::endl;
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    // The bitsliced engine runs even a single replication in a batch
+    if (args::get(replications) > 1 || parameters.engine == RoadEngine::BitSliced) {
+        // Replications run unpaced and without rendering on the thread pool
+        std::shared_ptr<BackgroundWriter> combined;
+        if (args::get(output_dir).empty()) {
+            // Combined output with the replication number in the first column,
+            // blocks of rows of different replications may interleave
+            combined = std::make_shared<BackgroundWriter>(std::cerr);
+            combined->write("replica;" + TrafficDataSink::csv_header(lanes, snapshots));
+        }
+        else {
+            std::filesystem::create_directories(args::get(output_dir));
+        }
+        ThreadPool pool(args::get(threads));
+        std::atomic<bool> failed {false};
+        if (parameters.engine == RoadEngine::Replicas || parameters.engine == RoadEngine::BitSliced) {
+            // Batches of replications share one road, each batch runs on one thread
+            uint32_t width = ReplicaSimulator::width(parameters.engine);
+            for (uint32_t first = 0; first < args::get(replications); first += width) {
+                uint32_t count = std::min(width, args::get(replications) - first);
+                pool.submit([&, first, count] {
+                    ReplicaSimulator simulator(parameters, seed, first, count);
+                    try {
+                        std::vector<std::unique_ptr<TrafficDataSink>> sinks;
+                        std::vector<TrafficDataSink*> batch;
+                        for (uint32_t replica = first; replica < first + count; ++replica) {
+                            if (combined) {
+                                sinks.push_back(std::make_unique<CsvSink>(combined, lanes, snapshots, false, replica + 1));
+                            }
+                            else {
+                                sinks.push_back(make_file_sink(replica));
+                            }
+                            batch.push_back(sinks.back().get());
+                        }
+                        simulator.simulate(seconds, batch);
+                    }
+                    catch (std::runtime_error& e) {
+                        std::cerr << e.what() << std::endl;
+                        failed = true;
+                    }
+                });
+            }
+            pool.wait();
+            return finish_output(combined, failed);
+        }
+        for (uint32_t replica = 0; replica < args::get(replications); ++replica) {
+            pool.submit([&, replica] {
+                auto simulator = make_simulator(replica);
+                simulator->set_render_interval(0);
+                Pacer pacer;
+                try {
+                    auto recorder = make_recorder(replica);
+                    simulator->set_recorder(recorder.get());
+                    if (combined) {
+                        CsvSink sink(combined, lanes, snapshots, false, replica + 1);
+                        simulator->simulate(seconds, pacer, sink);
+                    }
+                    else {
+                        auto sink = make_file_sink(replica);
+                        simulator->simulate(seconds, pacer, *sink);
+                    }
+                }
+                catch (std::runtime_error& e) {
+                    std::cerr << e.what() << std::endl;
+                    failed = true;
+                }
+            });
+        }
+        pool.wait();
+        return finish_output(combined, failed);
+    }
+
+    auto simulator = make_simulator(0);
+
+    // Pacing against the real time, speed-up of 0 means no pacing as well
+    float speed_up = args::get(sim_speed_up);
+    bool paced = !batch && speed_up > 0;
+    Pacer pacer = paced ? Pacer(speed_up) : Pacer();
+
+    // Render every n-th step to keep the requested frame rate, every step in batch mode
+    int render_interval = 0;
+    if (!headless && args::get(render_fps) > 0) {
+        render_interval = paced ? std::max(1, static_cast<int>(speed_up / args::get(render_fps))) : 1;
+    }
+    simulator->set_render_interval(render_interval);
+
+    std::unique_ptr<TrafficDataSink> sink;
+    std::unique_ptr<SpaceTimeRecorder> recorder;
+    try {
+        recorder = make_recorder(0);
+        simulator->set_recorder(recorder.get());
+        if (args::get(output_dir).empty()) {
+            sink = std::make_unique<CsvSink>(std::make_shared<BackgroundWriter>(std::cerr), lanes, snapshots);
+        }
+        else {
+            std::filesystem::create_directories(args::get(output_dir));
+            sink = make_file_sink(0);
+        }
+    }
+    catch (std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
 
     // Run the simulation
-    auto traffic_stats = simulator->simulate(static_cast<int>(args::get(time) * HOUR_SEC), args::get(sim_speed_up));
-    std::cerr << traffic_stats->to_csv();
+    try {
+        simulator->simulate(seconds, pacer, *sink);
+    }
+    catch (std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    sink.reset(); // Waits for the writer
+    if (pacer.missed_frames() > 0) {
+        std::cout << "Missed frames: " << pacer.missed_frames() << std::endl;
+    }
+    return finish_output(nullptr, false);
 }
\ No newline at end of file
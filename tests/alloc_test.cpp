@@ -0,0 +1,205 @@
+/**
+ * @authors Samuel Stolarik, Jan Pavlicek
+ * @date 18-12-2023
+ * @file alloc_test.cpp
+ *
+ * Checks that the steps of a warmed up simulation do not allocate, for every engine with and without snapshots
+ */
+
+#include "include/TrafficSimulator.h"
+#include "include/TrafficData.h"
+#include "include/Pacer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::atomic<uint64_t> allocations {0};
+
+void* counted_alloc(std::size_t size, std::size_t alignment) {
+    ++allocations;
+    size = size == 0 ? 1 : size;
+    void* memory = alignment > alignof(std::max_align_t)
+                       ? std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)
+                       : std::malloc(size);
+    if (!memory) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+}
+
+void* operator new(std::size_t size) {
+    return counted_alloc(size, alignof(std::max_align_t));
+}
+
+void* operator new[](std::size_t size) {
+    return counted_alloc(size, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return counted_alloc(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return counted_alloc(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+namespace {
+
+/**
+ * Steps taken before counting, the queue, the snapshot strings and the spare storage reach their sizes
+ */
+const int WARMUP_STEPS = 2000;
+
+/**
+ * Counted steps
+ */
+const int STEPS = 10000;
+
+/**
+ * Counts the allocations between its sample after the warm up and its last sample
+ * The setup of simulate() allocates, so only the steps inside its loop are counted.
+ */
+class AllocationSink : public TrafficDataSink {
+public:
+    explicit AllocationSink(bool snapshots) : m_snapshots(snapshots), m_samples(0), m_first(0), m_last(0) {}
+
+    void add_sample(const TrafficDataSample&) override {
+        uint64_t count = allocations;
+        if (m_samples == WARMUP_STEPS) {
+            m_first = count;
+        }
+        m_last = count;
+        ++m_samples;
+    }
+
+    bool wants_snapshots() const override {
+        return m_snapshots;
+    }
+
+    uint64_t counted() const {
+        return m_last - m_first;
+    }
+
+private:
+    bool m_snapshots;
+    int m_samples;
+    uint64_t m_first;
+    uint64_t m_last;
+};
+
+struct Scenario {
+    std::string name;
+    SimulationParameters parameters;
+};
+
+std::vector<Scenario> scenarios() {
+    std::vector<Scenario> result;
+    auto add = [&result](const std::string& name, RoadEngine engine, SimType type, UpdateRule rule, bool cars_only) {
+        SimulationParameters parameters;
+        parameters.engine = engine;
+        parameters.type = type;
+        parameters.update_rule = rule;
+        parameters.arrival_interval = 2;
+        if (cars_only) {
+            std::fill(parameters.portions.begin() + 1, parameters.portions.end(), 0);
+        }
+        result.push_back({name, parameters});
+    };
+    add("cells one-lane", RoadEngine::Cells, SimType::OneLane, UpdateRule::Sequential, false);
+    add("cells one-lane synchronous", RoadEngine::Cells, SimType::OneLane, UpdateRule::Synchronous, false);
+    add("cells two-lane", RoadEngine::Cells, SimType::TwoLane, UpdateRule::Sequential, false);
+    add("vehicle-list", RoadEngine::VehicleList, SimType::OneLane, UpdateRule::Sequential, false);
+    add("parallel", RoadEngine::Parallel, SimType::OneLane, UpdateRule::Sequential, false);
+    add("simd", RoadEngine::Simd, SimType::OneLane, UpdateRule::Sequential, true);
+    add("replicas", RoadEngine::Replicas, SimType::OneLane, UpdateRule::Sequential, false);
+    add("bitsliced", RoadEngine::BitSliced, SimType::OneLane, UpdateRule::Synchronous, true);
+    return result;
+}
+
+/**
+ * @return allocations of the counted steps of the most allocating replication
+ */
+uint64_t count_allocations(const SimulationParameters& parameters, bool snapshots) {
+    int seconds = WARMUP_STEPS + STEPS + 1;
+    if (parameters.engine == RoadEngine::Replicas || parameters.engine == RoadEngine::BitSliced) {
+        uint32_t replicas = ReplicaSimulator::width(parameters.engine);
+        std::vector<AllocationSink> sinks(replicas, AllocationSink(snapshots));
+        std::vector<TrafficDataSink*> sink_pointers;
+        for (auto& sink : sinks) {
+            sink_pointers.push_back(&sink);
+        }
+        ReplicaSimulator simulator(parameters, 1, 0, replicas);
+        simulator.simulate(seconds, sink_pointers);
+        uint64_t most = 0;
+        for (const auto& sink : sinks) {
+            most = std::max(most, sink.counted());
+        }
+        return most;
+    }
+    AllocationSink sink(snapshots);
+    TrafficSimulator simulator(parameters, StreamKey {1, 0});
+    simulator.set_render_interval(0);
+    Pacer pacer;
+    simulator.simulate(seconds, pacer, sink);
+    return sink.counted();
+}
+
+}
+
+int main() {
+    bool passed = true;
+    for (const auto& scenario : scenarios()) {
+        for (bool snapshots : {false, true}) {
+            uint64_t counted = count_allocations(scenario.parameters, snapshots);
+            std::cout << scenario.name << (snapshots ? ", snapshots: " : ": ") << counted << " allocations in " << STEPS
+                      << " steps" << std::endl;
+            passed = passed && counted == 0;
+        }
+    }
+    if (!passed) {
+        std::cerr << "The steps of a warmed up simulation allocate" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}